@@ -449,9 +449,11 @@
 #define glAlphaFunc			jwzgles_glAlphaFunc
 #define glBindTexture			jwzgles_glBindTexture
 #define glBlendFunc			jwzgles_glBlendFunc
+#define glBufferSubData			jwzgles_glBufferSubData
 #define glClear				jwzgles_glClear
 #define glClearColor			jwzgles_glClearColor
 #define glClearStencil			jwzgles_glClearStencil
+#define glClientActiveTexture		jwzgles_glClientActiveTexture
 #define glColor4f			jwzgles_glColor4f
 #define glColorMask			jwzgles_glColorMask
 #define glColorPointer			jwzgles_glColorPointer
@@ -522,4 +524,212 @@
 #define glGetError          jwzgles_glGetError
 #define glGetString          jwzgles_glGetString
 
+
+/* Define JWZGLES_INLINE_EMITTERS before including this to have the calls
+   made for every vertex between glBegin and glEnd compiled inline: they
+   write straight into the batch and the current attributes instead of
+   going through three or four wrappers each.  Whatever the fast path
+   doesn't cover (a full arena, normals or a second texture unit in the
+   batch, calls outside glBegin) still goes to jwzgles.c.
+ */
+#ifdef JWZGLES_INLINE_EMITTERS
+
+#include <stddef.h>
+#include <string.h>
+
+/* The current colour and texture coordinates are stored and loaded as
+   whole words, the same size each way round, so that the copy into the
+   vertex doesn't stall waiting for the stores before it to land.
+ */
+
+static inline void
+jwzgles_inline_glVertex3f (GLfloat x, GLfloat y, GLfloat z)
+{
+    jwzgles_batch_cursor *c = &jwzgles_cursor;
+    if (c->plain && c->next != c->end)
+    {
+        VertexAttribPacked *v = (VertexAttribPacked *) c->next;
+        v->x = x;
+        v->y = y;
+        v->z = z;
+        if (z != 0)
+            c->has_z = 1;
+        memcpy (&v->red, &c->packed.red, 4);
+        if (c->textured)
+            memcpy (&v->s, &c->packed.s, 2 * sizeof(GLfloat));
+        c->next += c->stride;
+    }
+    else
+        jwzgles_glVertex3f (x, y, z);
+}
+
+static inline void
+jwzgles_inline_glVertex2f (GLfloat x, GLfloat y)
+{
+    jwzgles_inline_glVertex3f (x, y, 0);
+}
+
+static inline void
+jwzgles_inline_glVertex3fv (const GLfloat *v)
+{
+    jwzgles_inline_glVertex3f (v[0], v[1], v[2]);
+}
+
+static inline void
+jwzgles_inline_glVertex2fv (const GLfloat *v)
+{
+    jwzgles_inline_glVertex3f (v[0], v[1], 0);
+}
+
+static inline void
+jwzgles_inline_glVertex3i (GLint x, GLint y, GLint z)
+{
+    jwzgles_inline_glVertex3f (x, y, z);
+}
+
+static inline void
+jwzgles_inline_glVertex2i (GLint x, GLint y)
+{
+    jwzgles_inline_glVertex3f (x, y, 0);
+}
+
+static inline void
+jwzgles_inline_glTexCoord2f (GLfloat s, GLfloat t)
+{
+    GLfloat st[2];
+    st[0] = s;
+    st[1] = t;
+    memcpy (&jwzgles_cursor.attrib.s, st, sizeof(st));
+    memcpy (&jwzgles_cursor.packed.s, st, sizeof(st));
+}
+
+static inline void
+jwzgles_inline_glTexCoord2fv (const GLfloat *v)
+{
+    jwzgles_inline_glTexCoord2f (v[0], v[1]);
+}
+
+static inline void
+jwzgles_inline_glColor4f (GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    jwzgles_batch_cursor *c = &jwzgles_cursor;
+    if (!c->in_begin)
+        jwzgles_glColor4f (r, g, b, a);
+    else if (c->compact)
+    {
+        GLubyte rgba[4];
+        rgba[0] = jwzgles_color_byte (r);
+        rgba[1] = jwzgles_color_byte (g);
+        rgba[2] = jwzgles_color_byte (b);
+        rgba[3] = jwzgles_color_byte (a);
+        memcpy (&c->packed.red, rgba, 4);
+        jwzgles_note_color (c);
+    }
+    else
+    {
+        c->attrib.red   = r;
+        c->attrib.green = g;
+        c->attrib.blue  = b;
+        c->attrib.alpha = a;
+        jwzgles_note_color (c);
+    }
+}
+
+static inline void
+jwzgles_inline_glColor3f (GLfloat r, GLfloat g, GLfloat b)
+{
+    jwzgles_inline_glColor4f (r, g, b, 1);
+}
+
+static inline void
+jwzgles_inline_glColor4fv (const GLfloat *v)
+{
+    jwzgles_inline_glColor4f (v[0], v[1], v[2], v[3]);
+}
+
+static inline void
+jwzgles_inline_glColor3fv (const GLfloat *v)
+{
+    jwzgles_inline_glColor4f (v[0], v[1], v[2], 1);
+}
+
+static inline void
+jwzgles_inline_glColor4ub (GLubyte r, GLubyte g, GLubyte b, GLubyte a)
+{
+    jwzgles_batch_cursor *c = &jwzgles_cursor;
+    if (!c->in_begin)
+        jwzgles_glColor4ub (r, g, b, a);
+    else if (c->compact)
+    {
+        GLubyte rgba[4];
+        rgba[0] = r;
+        rgba[1] = g;
+        rgba[2] = b;
+        rgba[3] = a;
+        memcpy (&c->packed.red, rgba, 4);
+        jwzgles_note_color (c);
+    }
+    else
+    {
+        c->attrib.red   = r / 255.0f;
+        c->attrib.green = g / 255.0f;
+        c->attrib.blue  = b / 255.0f;
+        c->attrib.alpha = a / 255.0f;
+        jwzgles_note_color (c);
+    }
+}
+
+static inline void
+jwzgles_inline_glColor3ub (GLubyte r, GLubyte g, GLubyte b)
+{
+    jwzgles_inline_glColor4ub (r, g, b, 255);
+}
+
+static inline void
+jwzgles_inline_glColor4ubv (const GLubyte *v)
+{
+    jwzgles_inline_glColor4ub (v[0], v[1], v[2], v[3]);
+}
+
+static inline void
+jwzgles_inline_glColor3ubv (const GLubyte *v)
+{
+    jwzgles_inline_glColor4ub (v[0], v[1], v[2], 255);
+}
+
+# undef glVertex2f
+# undef glVertex2fv
+# undef glVertex2i
+# undef glVertex3f
+# undef glVertex3fv
+# undef glVertex3i
+# undef glTexCoord2f
+# undef glTexCoord2fv
+# undef glColor3f
+# undef glColor3fv
+# undef glColor3ub
+# undef glColor3ubv
+# undef glColor4f
+# undef glColor4fv
+# undef glColor4ub
+# undef glColor4ubv
+# define glVertex2f			jwzgles_inline_glVertex2f
+# define glVertex2fv			jwzgles_inline_glVertex2fv
+# define glVertex2i			jwzgles_inline_glVertex2i
+# define glVertex3f			jwzgles_inline_glVertex3f
+# define glVertex3fv			jwzgles_inline_glVertex3fv
+# define glVertex3i			jwzgles_inline_glVertex3i
+# define glTexCoord2f			jwzgles_inline_glTexCoord2f
+# define glTexCoord2fv			jwzgles_inline_glTexCoord2fv
+# define glColor3f			jwzgles_inline_glColor3f
+# define glColor3fv			jwzgles_inline_glColor3fv
+# define glColor3ub			jwzgles_inline_glColor3ub
+# define glColor3ubv			jwzgles_inline_glColor3ubv
+# define glColor4f			jwzgles_inline_glColor4f
+# define glColor4fv			jwzgles_inline_glColor4fv
+# define glColor4ub			jwzgles_inline_glColor4ub
+# define glColor4ubv			jwzgles_inline_glColor4ubv
+
+#endif /* JWZGLES_INLINE_EMITTERS */
+
 #endif /* __JWZGLES_H__ */
@@ -115,6 +115,16 @@
 # define GL_V3F					0x2A21
 # define GL_VIEWPORT_BIT			0x00000800
 # define GL_INT					0x1404
+# ifndef GL_UNSIGNED_INT
+#  define GL_UNSIGNED_INT				0x1405
+# endif
+# ifndef GL_POINT_SPRITE_OES
+#  define GL_POINT_SPRITE_OES			0x8861
+#  define GL_COORD_REPLACE_OES			0x8862
+# endif
+# ifndef GL_POINT_SIZE_ARRAY_OES
+#  define GL_POINT_SIZE_ARRAY_OES		0x8B9C
+# endif
 # define GL_DOUBLE				0x140A
 
 #define GL_COMBINE				0x8570
@@ -157,6 +167,199 @@ extern void jwzgles_reset (void);
 
 extern void jwzgles_restore (void);
 
+/* Frame boundary, tuning knobs and counters for the glBegin/glEnd batcher.
+ */
+#define JWZGLES_ARENA_SHRINK_FRAMES	0x0001	/* idle frames before the
+                                                   arena shrinks; 0 = never */
+#define JWZGLES_COMPACT_VERTS		0x0002	/* 1 = RGBA8 colour (default),
+                                                   0 = float colour */
+#define JWZGLES_SORT_BY_TEXTURE		0x0003	/* 1 = group opaque depth-tested
+                                                   batches by texture */
+#define JWZGLES_VBO_RING		0x0004	/* N = stream batches through
+                                                   N VBOs; 0 = off (default) */
+#define JWZGLES_WIDE_LINES		0x0005	/* 1 = draw lines as quads of
+                                                   the line width; 0 = off
+                                                   (default) */
+#define JWZGLES_BATCH_VERTS		0x0006	/* N = draw the batch once it
+                                                   holds N vertexes; 0 = as
+                                                   many as an index can
+                                                   address (default) */
+#define JWZGLES_BATCH_CACHE		0x0007	/* N = keep up to N bytes of
+                                                   batches that repeat in
+                                                   VBOs; 0 = off (default) */
+#define JWZGLES_MERGE_ARRAYS		0x0008	/* N = copy glDrawArrays calls
+                                                   of up to N vertexes from
+                                                   client memory into the
+                                                   batch; 0 = off (default) */
+#define JWZGLES_FRUSTUM_CULL		0x0009	/* N = leave out glBegin blocks
+                                                   of N or more vertexes that
+                                                   are wholly off screen;
+                                                   0 = off (default) */
+
+#define JWZGLES_STAT_ARENA_VERTS	0x1001	/* vertexes allocated, of the
+                                                   layout in use */
+#define JWZGLES_STAT_ARENA_INDEXES	0x1002	/* indexes allocated */
+#define JWZGLES_STAT_ARENA_VERTS_HWM	0x1003	/* most vertexes ever batched */
+#define JWZGLES_STAT_ARENA_INDEXES_HWM	0x1004	/* most indexes ever batched */
+#define JWZGLES_STAT_ARENA_BYTES	0x1005	/* bytes allocated */
+#define JWZGLES_STAT_BATCH_SPLITS	0x1006	/* batches cut short by the
+                                                   vertex limit */
+#define JWZGLES_STAT_VERTEX_STRIDE	0x1007	/* bytes per batched vertex */
+#define JWZGLES_STAT_STATE_FILTERED	0x1008	/* state calls dropped because
+                                                   nothing changed */
+#define JWZGLES_STAT_SORT_QUEUED	0x1009	/* batches held back to be
+                                                   drawn by texture */
+#define JWZGLES_STAT_RING_UPLOADED	0x100A	/* bytes copied into the
+                                                   VBO ring */
+#define JWZGLES_STAT_QUAD_BATCHES	0x100B	/* batches drawn with the
+                                                   shared quad indexes */
+#define JWZGLES_STAT_LINES_WIDENED	0x100C	/* line segments drawn as
+                                                   quads */
+#define JWZGLES_STAT_POINTS_WIDENED	0x100D	/* points drawn as quads */
+#define JWZGLES_STAT_CONSTANT_COLOR	0x100E	/* batches drawn with one
+                                                   glColor instead of the
+                                                   colour array */
+#define JWZGLES_STAT_FLAT_BATCHES	0x100F	/* batches drawn with only
+                                                   x and y */
+#define JWZGLES_STAT_CACHE_HITS		0x1010	/* batches drawn from the
+                                                   batch cache */
+#define JWZGLES_STAT_CACHE_BYTES	0x1011	/* bytes the batch cache
+                                                   holds */
+#define JWZGLES_STAT_ARRAYS_MERGED	0x1012	/* glDrawArrays calls copied
+                                                   into the batch */
+#define JWZGLES_STAT_INDEXES_CONVERTED	0x1013	/* draws whose quads or 32-bit
+                                                   indexes were converted */
+#define JWZGLES_STAT_CONVERT_HITS	0x1014	/* converted draws drawn from
+                                                   a kept buffer */
+#define JWZGLES_STAT_BLOCKS_CULLED	0x1015	/* glBegin blocks left out as
+                                                   off screen */
+
+extern void jwzgles_end_frame (void);
+extern void jwzgles_batch_option (int option, int value);
+extern long jwzgles_batch_stat (int stat);
+extern void jwzgles_emit_vertices (GLenum mode, int count,
+                                   const GLfloat *pos, int pos_stride,
+                                   const GLfloat *color, int color_stride,
+                                   const GLfloat *tex, int tex_stride);
+
+/* The vertexes of the glBegin/glEnd batcher in jwzgles_test.c, and the
+   part of its state that the inline emitters in jwzgles.h work on.
+   Internal: nothing else should touch these.
+ */
+typedef struct
+{
+    float x;
+    float y;
+    float z;
+    float padding;
+
+#if COLOR_BYTE
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
+    unsigned char alpha;
+#else
+    float red;
+    float green;
+    float blue;
+    float alpha;
+#endif
+
+    float s;
+    float t;
+
+    /* Optional: see vertex_offsets. */
+    float s_multi;		/* GL_TEXTURE1 */
+    float t_multi;
+    GLbyte nx, ny, nz, npad;	/* only while lighting is on */
+    float psize;		/* only with GL_OES_point_size_array */
+} VertexAttrib;
+
+/* The compact layout: the same vertex with the colour packed into
+   RGBA8, 24 bytes a vertex instead of 40.  This is the default; see
+   JWZGLES_COMPACT_VERTS.
+
+   Both layouts end with three optional parts.  A batch only stores the
+   second unit's texture coordinates (8 bytes) once it has been given
+   some, a GL_BYTE normal (4 bytes) when drawn with GL_LIGHTING on, and
+   the point size (4 bytes) once it has points in it and the driver can
+   take one per vertex.
+ */
+typedef struct
+{
+    float x;
+    float y;
+    float z;
+
+    GLubyte red;
+    GLubyte green;
+    GLubyte blue;
+    GLubyte alpha;
+
+    float s;
+    float t;
+
+    float s_multi;
+    float t_multi;
+    GLbyte nx, ny, nz, npad;
+    float psize;
+} VertexAttribPacked;
+
+typedef struct
+{
+    unsigned char *next;	/* where the next vertex goes */
+    unsigned char *end;		/* the arena is full from here on */
+    unsigned char *start;	/* the batch's first vertex */
+    int compact;		/* the batch holds VertexAttribPacked */
+    int plain;			/* ... and only up to s_multi of each */
+    int textured;		/* ... which has s and t */
+    int stride;			/* bytes from one vertex to the next */
+    int in_begin;		/* between glBegin and glEnd */
+    int recolored;		/* vertexes from this one on may not be in
+                                   the first one's colour; 0 if none */
+    int has_z;			/* some vertex has z != 0 */
+    VertexAttrib attrib;	/* the attributes the next vertex gets */
+    VertexAttribPacked packed;
+} jwzgles_batch_cursor;
+
+extern jwzgles_batch_cursor jwzgles_cursor;
+
+/* A colour component as it is stored in the compact layout. */
+static inline GLubyte
+jwzgles_color_byte (GLfloat f)
+{
+    if (f <= 0) return 0;
+    if (f >= 1) return 255;
+    return (GLubyte) (f * 255 + 0.5);
+}
+
+/* Call after setting the current colour.  If it isn't the batch's
+   first vertex's, the batch is drawn with the colour array once a
+   vertex has been added in it.
+ */
+static inline void
+jwzgles_note_color (jwzgles_batch_cursor *c)
+{
+    int differs;
+
+    if (c->recolored || c->next == c->start)
+        return;
+    if (c->compact)
+    {
+        const VertexAttribPacked *v = (const VertexAttribPacked *) c->start;
+        differs = (v->red != c->packed.red || v->green != c->packed.green ||
+                   v->blue != c->packed.blue || v->alpha != c->packed.alpha);
+    }
+    else
+    {
+        const VertexAttrib *v = (const VertexAttrib *) c->start;
+        differs = (v->red != c->attrib.red || v->green != c->attrib.green ||
+                   v->blue != c->attrib.blue || v->alpha != c->attrib.alpha);
+    }
+    if (differs)
+        c->recolored = (int) ((c->next - c->start) / c->stride);
+}
+
     //for GZdoom
 void glVertexAttrib1f(	GLuint index,
                           GLfloat v0);
@@ -204,6 +407,7 @@ extern void jwzgles_glPopAttrib(void);
    to allow them to be recorded.
  */
 extern void jwzgles_glActiveTexture (GLuint);
+extern void jwzgles_glClientActiveTexture (GLuint);
 extern void jwzgles_glBindTexture (GLuint, GLuint);
 extern void jwzgles_glBlendFunc (GLuint, GLuint);
 extern void jwzgles_glBlendEquation(GLuint);
@@ -216,6 +420,7 @@ extern void jwzgles_glDepthFunc (GLuint);
 extern void jwzgles_glDepthMask (GLuint);
 extern void jwzgles_glDisable (GLuint);
 extern void jwzgles_glDrawArrays (GLuint, GLuint, GLuint);
+extern void jwzgles_glArrayElement (GLint);
 extern GLboolean jwzgles_glIsEnabled (GLuint);
 extern void jwzgles_glEnable (GLuint);
 extern void jwzgles_glFrontFace (GLuint);
@@ -384,6 +589,8 @@ extern void jwzgles_glColorPointer (GLuint, GLuint, GLuint, const void *);
 extern void jwzgles_glTexCoordPointer (GLuint, GLuint, GLuint, const void *);
 extern void jwzgles_glBindBuffer (GLuint, GLuint);
 extern void jwzgles_glBufferData (GLenum, GLsizeiptr, const void *, GLenum);
+extern void jwzgles_glBufferSubData (GLenum, GLintptr, GLsizeiptr,
+                                     const void *);
 
 extern void jwzgles_glGenBuffers (GLsizei n, GLuint *buffers);
 extern void jwzgles_glDeleteBuffers (GLsizei n, const GLuint *buffers);
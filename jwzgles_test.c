@@ -1,475 +1,3656 @@
-
-# include <GLES/gl.h>
-#include "jwzglesI.h"
-
-#include <android/log.h>
-#define LOG_TAG "JWZGLES"
-#define LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
-
-#define LOGI(...)
-
-//#define  __MULTITEXTURE_SUPPORT__
-
-typedef struct
-{
-    float x;
-    float y;
-    float z;
-#if !defined(__MULTITEXTURE_SUPPORT__)
-    float padding;
-#endif
-
-#if COLOR_BYTE
-    unsigned char red;
-    unsigned char green;
-    unsigned char blue;
-    unsigned char alpha;
-#else
-    float red;
-    float green;
-    float blue;
-    float alpha;
-#endif
-
-    float s;
-    float t;
-#if defined(__MULTITEXTURE_SUPPORT__)
-    float s_multi;
-    float t_multi;
-#endif
-} VertexAttrib;
-
-static GLenum wrapperPrimitiveMode = GL_QUADS;
-GLboolean useTexCoordArray = GL_FALSE;
-
-#define SIZE_VERTEXATTRIBS 200000
-static VertexAttrib vertexattribs[SIZE_VERTEXATTRIBS];
-
-#define SIZE_INDEXARRAY ( SIZE_VERTEXATTRIBS * 4 )
-static GLushort indexArray[SIZE_INDEXARRAY];
-
-static GLuint vertexCount = 0;
-static GLuint indexCount = 0;
-static GLuint vertexMark = 0;
-static int indexbase = 0;
-
-static VertexAttrib* ptrVertexAttribArray = NULL;
-static VertexAttrib* ptrVertexAttribArrayMark = NULL;
-
-static VertexAttrib currentVertexAttrib = {0};
-
-static GLushort* ptrIndexArray = NULL;
-
-static int glBegin_active = 0;
-
-void FlushOnStateChange()
-{
-    //LOGI("FlushOnStateChange");
-    /*
-    	if (delayedttmuchange)
-    	{
-    		LOGI("FlushOnStateChange delayedttmuchange");
-    		delayedttmuchange = GL_FALSE;
-    		GLESIMPL glActiveTexture(delayedtmutarget);
-    		CHECKGLERROR;
-    	}
-    */
-    if (!vertexCount)
-        return;
-
-    LOGI("FlushOnStateChange drawing %d", vertexCount);
-
-
-    //if (!arraysValid)
-    {
-        //LOGI("FlushOnStateChange arrays NOT valid");
-
-        glClientActiveTexture(GL_TEXTURE0);
-
-        if( state->element_array_buffer != 0 )
-        {
-            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
-            state->element_array_buffer = 0;
-        }
-
-        if( state->array_buffer != 0 )
-        {
-            glBindBuffer (GL_ARRAY_BUFFER, 0);
-            state->array_buffer = 0;
-        }
-
-        if( !state->vertPrtValid )
-        {
-            if (wrapperPrimitiveMode == GL_LINES)
-                glVertexPointer(2, GL_FLOAT, sizeof(VertexAttrib), &vertexattribs[0].x);
-            else
-                glVertexPointer(3, GL_FLOAT, sizeof(VertexAttrib), &vertexattribs[0].x);
-
-            state->vertPrtValid = 1;
-        }
-
-        if( !state->colorPtrValid )
-        {
-            glColorPointer(4, GL_FLOAT, sizeof(VertexAttrib), &vertexattribs[0].red);
-            state->colorPtrValid = 1;
-        }
-
-        if( !state->texPrtValid )
-        {
-            glTexCoordPointer(2, GL_FLOAT, sizeof(VertexAttrib), &vertexattribs[0].s);
-            state->texPrtValid = 1;
-        }
-
-        if( !(state->enabled & ISENABLED_VERT_ARRAY) )
-        {
-            glEnableClientState(GL_VERTEX_ARRAY);
-        }
-
-        if( !(state->enabled & ISENABLED_TEX_ARRAY) )
-        {
-            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-        }
-
-        if( !(state->enabled & ISENABLED_COLOR_ARRAY) )
-        {
-            glEnableClientState(GL_COLOR_ARRAY);
-        }
-
-#if defined(__MULTITEXTURE_SUPPORT__)
-        glClientActiveTexture(GL_TEXTURE1);
-
-        glTexCoordPointer(2, GL_FLOAT, sizeof(VertexAttrib), &vertexattribs[0].s_multi);
-
-        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-        glClientActiveTexture(GL_TEXTURE0);
-
-#endif
-        //arraysValid = GL_TRUE;
-    }
-
-
-#if CHECK_OVERFLOW
-    if ( ptrVertexAttribArray >= vertexattribs + SIZE_VERTEXATTRIBS)
-    {
-        FatalError("vertexattribs overflow\n");
-    }
-    if ( ptrIndexArray >= indexArray + SIZE_INDEXARRAY)
-    {
-        FatalError("indexArray overflow\n");
-    }
-#endif
-
-    //LOGI("FlushOnStateChange draw ");
-    //glEnable(GL_DEPTH_TEST) ;
-    //glClear(GL_DEPTH_BUFFER_BIT);
-
-    if (wrapperPrimitiveMode == GL_LINES)
-    {
-        glDrawElements( GL_LINES,vertexCount,GL_UNSIGNED_SHORT, indexArray );
-    }
-    else if (wrapperPrimitiveMode == GL_QUADS)
-    {
-        glDrawElements( GL_TRIANGLES,vertexCount,GL_UNSIGNED_SHORT, indexArray );
-    }
-    else
-        glDrawElements( GL_TRIANGLES,vertexCount,GL_UNSIGNED_SHORT, indexArray );
-
-
-    if( !(state->enabled & ISENABLED_VERT_ARRAY) )
-    {
-        glDisableClientState(GL_VERTEX_ARRAY);
-    }
-
-    if( !(state->enabled & ISENABLED_TEX_ARRAY) )
-    {
-        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    }
-
-    if( !(state->enabled & ISENABLED_COLOR_ARRAY) )
-    {
-        glDisableClientState(GL_COLOR_ARRAY);
-    }
-
-/*
-    if( state->element_array_buffer != 0 )
-        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, state->element_array_buffer);
-*/
-
-    if( state->array_buffer != 0 )
-    {
-        //glBindBuffer (GL_ARRAY_BUFFER, state->array_buffer);
-    }
-
-    vertexCount = 0;
-    indexCount = 0;
-    ptrVertexAttribArray = vertexattribs;
-    ptrVertexAttribArrayMark = ptrVertexAttribArray;
-    ptrIndexArray = indexArray;
-    useTexCoordArray = GL_FALSE;
-}
-
-void
-jwzgles_glBegin_OVERRIDE(int mode)
-{
-    wrapperPrimitiveMode = mode;
-}
-
-void
-jwzgles_glBegin(int mode)
-{
-    LOGI("glBegin mode = %d, vcount = %d, icount = %d", mode,vertexCount,indexCount);
-    static int first = 1;
-
-    glBegin_active = 1;
-
-    if(first)
-    {
-        first = 0;
-        wrapperPrimitiveMode = mode;
-        vertexCount = 0;
-        indexCount = 0;
-        ptrVertexAttribArray = vertexattribs;
-        ptrVertexAttribArrayMark = ptrVertexAttribArray;
-        ptrIndexArray = indexArray;
-    }
-    else
-    {
-        wrapperPrimitiveMode = mode;
-        vertexMark = vertexCount;
-        ptrVertexAttribArrayMark = ptrVertexAttribArray;
-        indexbase = indexCount;
-    }
-}
-
-
-void jwzgles_glEnd(void)
-{
-    int count ;
-
-    LOGI("glEnd");
-
-    glBegin_active = 0;
-
-    vertexCount+=((unsigned char*)ptrVertexAttribArray-(unsigned char*)ptrVertexAttribArrayMark)/sizeof(VertexAttrib);
-    if (vertexCount < ((wrapperPrimitiveMode == GL_LINES)?2:3))
-    {
-        return;
-    }
-    switch (wrapperPrimitiveMode)
-    {
-    case GL_LINES:
-    {
-        int  vcount = (vertexCount-vertexMark)/2;
-        for ( count = 0; count < vcount; count++)
-        {
-            *ptrIndexArray++ = indexCount;
-            *ptrIndexArray++ = indexCount+1;
-            indexCount+=2;
-        }
-        //indexCount+=4;
-        //vertexCount+=2;
-    }
-    break;
-    case GL_QUADS:
-    {
-        int i;
-        int  vcount = (vertexCount-vertexMark);
-        for (i = 0; i < vcount * 3 ; i+=6 )
-        {
-            int q = i / 6 * 4;
-            ptrIndexArray[ i + 0 ] = q + 0;
-            ptrIndexArray[ i + 1 ] = q + 1;
-            ptrIndexArray[ i + 2 ] = q + 2;
-
-            ptrIndexArray[ i + 3 ] = q + 0;
-            ptrIndexArray[ i + 4 ] = q + 2;
-            ptrIndexArray[ i + 5 ] = q + 3;
-
-            indexCount+=4;
-        }
-        vertexCount =  vcount / 4 * 6;
-    }
-    break;
-    /*
-    case GL_QUAD_STRIP:
-    {
-        int i;
-        int  vcount = (vertexCount-vertexMark);
-        for (i = 0; i < vcount * 3 ; i+=6 )
-        {
-            int q = i / 6 * 4;
-            ptrIndexArray[ i + 0 ] = q + 0;
-            ptrIndexArray[ i + 1 ] = q + 1;
-            ptrIndexArray[ i + 2 ] = q + 2;
-
-            ptrIndexArray[ i + 3 ] = q + 0;
-            ptrIndexArray[ i + 4 ] = q + 2;
-            ptrIndexArray[ i + 5 ] = q + 3;
-
-            indexCount+=4;
-        }
-        vertexCount =  vcount / 4 * 6;
-    }
-    break;
-    */
-    case GL_TRIANGLES:
-    {
-        int  vcount = (vertexCount-vertexMark)/3;
-        for ( count = 0; count < vcount; count++)
-        {
-            *ptrIndexArray++ = indexCount;
-            *ptrIndexArray++ = indexCount+1;
-            *ptrIndexArray++ = indexCount+2;
-            indexCount+=3;
-        }
-    }
-    break;
-    case GL_TRIANGLE_STRIP:
-    {
-        *ptrIndexArray++ = indexCount;
-        *ptrIndexArray++ = indexCount+1;
-        *ptrIndexArray++ = indexCount+2;
-        indexCount+=3;
-        int vcount = ((vertexCount-vertexMark)-3);
-
-        if (vcount && ((long)ptrIndexArray & 0x02))
-        {
-            *ptrIndexArray++ = indexCount-1; // 2
-            *ptrIndexArray++ = indexCount-2; // 1
-            *ptrIndexArray++ = indexCount;   // 3
-            indexCount++;
-            vcount-=1;
-
-            // bullshit optimization ....
-
-            int odd = vcount&1;
-            vcount/=2;
-            unsigned int* longptr = (unsigned int*) ptrIndexArray;
-
-            for ( count = 0; count < vcount; count++)
-            {
-                *(longptr++) = (indexCount-2) | ((indexCount-1)<<16);
-                *(longptr++) = (indexCount) | ((indexCount)<<16);
-                *(longptr++) = (indexCount-1) | ((indexCount+1)<<16);
-                indexCount+=2;
-            }
-            ptrIndexArray = (unsigned short*)(longptr);
-
-
-            if (odd)
-            {
-                *ptrIndexArray++ = indexCount-2; // 2
-                *ptrIndexArray++ = indexCount-1; // 1
-                *ptrIndexArray++ = indexCount;   // 3
-                indexCount++;
-            }
-        }
-        else
-        {
-            //already aligned
-            int odd = vcount&1;
-            vcount/=2;
-            unsigned int* longptr = (unsigned int*) ptrIndexArray;
-
-            for ( count = 0; count < vcount; count++)
-            {
-                *(longptr++) = (indexCount-1) | ((indexCount-2)<<16);
-                *(longptr++) = (indexCount) | ((indexCount-1)<<16);
-                *(longptr++) = (indexCount) | ((indexCount+1)<<16);
-                indexCount+=2;
-
-            }
-            ptrIndexArray = (unsigned short*)(longptr);
-            if (odd)
-            {
-
-                *ptrIndexArray++ = indexCount-1; // 2
-                *ptrIndexArray++ = indexCount-2; // 1
-                *ptrIndexArray++ = indexCount;   // 3
-                indexCount++;
-            }
-        }
-        vertexCount+=(vertexCount-vertexMark-3)*2;
-    }
-
-
-    break;
-    case GL_POLYGON:
-    case GL_TRIANGLE_FAN:
-    //case GL_QUAD_STRIP:
-    {
-
-        *ptrIndexArray++ = indexCount++;
-        *ptrIndexArray++ = indexCount++;
-        *ptrIndexArray++ = indexCount++;
-        int vcount = ((vertexCount-vertexMark)-3);
-        for ( count = 0; count < vcount; count++)
-        {
-            *ptrIndexArray++ = indexbase;
-            *ptrIndexArray++ = indexCount-1;
-            *ptrIndexArray++ = indexCount++;
-            vertexCount+=2;
-        }
-    }
-    break;
-
-    default:
-        break;
-    }
-
-    // flush after glEnd()
-    if (wrapperPrimitiveMode == GL_LINES)
-        FlushOnStateChange(); //For gzdoom automap
-
-    //FlushOnStateChange(); //TEST
-}
-
-
-void jwzgles_glVertex4fv (const GLfloat *v)
-{
-    currentVertexAttrib.x = v[0];
-    currentVertexAttrib.y = v[1];
-    currentVertexAttrib.z = v[2];
-
-    ptrVertexAttribArray->x = currentVertexAttrib.x;
-    ptrVertexAttribArray->y = currentVertexAttrib.y;
-    ptrVertexAttribArray->z = currentVertexAttrib.z;
-
-    ptrVertexAttribArray->red = currentVertexAttrib.red;
-    ptrVertexAttribArray->green = currentVertexAttrib.green;
-    ptrVertexAttribArray->blue = currentVertexAttrib.blue;
-    ptrVertexAttribArray->alpha = currentVertexAttrib.alpha;
-
-    ptrVertexAttribArray->s = currentVertexAttrib.s;
-    ptrVertexAttribArray->t = currentVertexAttrib.t;
-#if defined(__MULTITEXTURE_SUPPORT__)
-    ptrVertexAttribArray->s_multi = currentVertexAttrib.s_multi;
-    ptrVertexAttribArray->t_multi = currentVertexAttrib.t_multi;
-#endif
-    if(ptrVertexAttribArray < vertexattribs + SIZE_VERTEXATTRIBS)
-        ptrVertexAttribArray ++;
-}
-
-void
-jwzgles_glTexCoord4fv (const GLfloat *v)
-{
-    currentVertexAttrib.s = v[0];
-    currentVertexAttrib.t = v[1];
-#if defined(__MULTITEXTURE_SUPPORT__)
-    currentVertexAttrib.s_multi = v[2];
-    currentVertexAttrib.t_multi = v[3];
-#endif
-}
-
-void
-jwzgles_glColor4fv (const GLfloat *v)
-{
-    currentVertexAttrib.red = v[0];
-    currentVertexAttrib.green =  v[1];
-    currentVertexAttrib.blue =  v[2];
-    currentVertexAttrib.alpha =  v[3];
-
-    if(!glBegin_active)
-        glColor4f (v[0], v[1], v[2], v[3]);
+
+# include <GLES/gl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "jwzglesI.h"
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+#include <android/log.h>
+#define LOG_TAG "JWZGLES"
+#define LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
+
+#define LOGI(...)
+
+/* The batcher's cursor and colour conversion (see jwzglesI.h) are
+   shared with the inline emitters in jwzgles.h.  These are the names
+   they had here before.
+   arena_init fills in the layout.
+ */
+jwzgles_batch_cursor jwzgles_cursor = { 0 };
+
+#define ptrVertexAttribArray	(jwzgles_cursor.next)
+#define ptrVertexAttribArrayEnd	(jwzgles_cursor.end)
+#define compactVerts		(jwzgles_cursor.compact)
+#define glBegin_active		(jwzgles_cursor.in_begin)
+#define currentVertexAttrib	(jwzgles_cursor.attrib)
+#define currentVertexPacked	(jwzgles_cursor.packed)
+#define batchRecolored		(jwzgles_cursor.recolored)
+#define batchHasZ		(jwzgles_cursor.has_z)
+#define color_byte		jwzgles_color_byte
+
+/* Which of the two VertexAttrib layouts the arena holds.  Both start
+   with x, y, z. */
+static int batchTexCoords = 1;		/* whether they have s, t */
+static int batchMulti = 0;		/* whether they have s_multi, t_multi */
+static int batchNormals = 0;		/* whether they have the normal */
+static int batchPointSizes = 0;		/* whether they have psize */
+static int compactWanted = 1;		/* JWZGLES_COMPACT_VERTS */
+static int vertBaseBytes = offsetof(VertexAttribPacked, s_multi);
+static int vertStride = offsetof(VertexAttribPacked, s_multi);
+static GLenum vertColorType = GL_UNSIGNED_BYTE;
+static int vertColorOffset = offsetof(VertexAttribPacked, red);
+static int vertTexOffset = offsetof(VertexAttribPacked, s);
+static int vertTexMultiOffset = 0;
+static int vertNormalOffset = 0;
+static int vertPointSizeOffset = 0;
+
+static void set_vertex_layout (int compact, int normals, int texcoords);
+static void vertex_offsets (void);
+static void set_batch_parts (int multi, int psizes);
+static void vertex_from_current (GLubyte *vert);
+static int split_block (void);
+
+/* Number of vertexes between two pointers into the arena. */
+#define VERT_COUNT(from, to) ((int) (((to) - (from)) / vertStride))
+
+static GLenum wrapperPrimitiveMode = GL_QUADS;
+GLboolean useTexCoordArray = GL_FALSE;
+
+/* Vertexes and indexes of the batch being built live in a heap arena
+   rather than in static arrays.  It starts small, doubles whenever a
+   batch needs more, and gives the memory back once it has been mostly
+   idle for shrink_frames frames (see jwzgles_end_frame).  The vertexes
+   are counted in bytes, at least enough for ARENA_MIN_VERTS of the
+   widest layout, so that switching layouts needs no new memory.
+ */
+#define ARENA_MIN_VERTS		1024
+#define ARENA_MIN_VERT_BYTES	( ARENA_MIN_VERTS * (int) sizeof(VertexAttrib) )
+#define ARENA_MIN_INDEXES	( ARENA_MIN_VERTS * 3 )
+#define ARENA_SHRINK_FRAMES	300
+
+typedef struct
+{
+    GLubyte *verts;		/* vertStride bytes each */
+    void *indexes;		/* GLushort or GLuint, as per indexType */
+    int vert_bytes, index_size;	/* allocated, in bytes and indexes */
+    int vert_peak, index_peak;	/* most used since the last frame boundary,
+                                   likewise */
+    int vert_hwm, index_hwm;	/* most vertexes and indexes ever used:
+                                   the high-water mark */
+    int quiet_frames;		/* consecutive frames using under a quarter */
+    int shrink_frames;		/* quiet frames before shrinking; 0 = never */
+} batch_arena;
+
+static batch_arena arena = { 0, };
+
+/* Indexes are 16 bits wide unless GL_OES_element_index_uint is around,
+   in which case they are 32 bits and a batch can be as big as the arena.
+   With 16 bit indexes a batch is split before its 65537th vertex.
+ */
+static GLenum indexType = GL_UNSIGNED_SHORT;
+static int indexBytes = sizeof(GLushort);
+static int maxBatchVerts = 0x10000;
+static int batchVertsCap = 0;		/* JWZGLES_BATCH_VERTS */
+static unsigned long batchSplits = 0;
+static int haveMapBuffer = 0;		/* GL_OES_mapbuffer */
+static int havePointSizeArray = 0;	/* GL_OES_point_size_array */
+
+/* Number of indexes written to the arena so far. */
+#define INDEXES_USED() \
+    ((int) (((GLubyte *) ptrIndexArray - (GLubyte *) arena.indexes) / indexBytes))
+#define INDEXES_ROOM()	(arena.index_size - INDEXES_USED())
+
+/* Run the statements with `out' pointing at the next free index, typed
+   for the width in use, and advance the index pointer past what they wrote.
+ */
+#define EMIT_INDEXES(...) do {						\
+    if (indexType == GL_UNSIGNED_INT) {					\
+        GLuint *out = (GLuint *) ptrIndexArray;				\
+        __VA_ARGS__;							\
+        ptrIndexArray = out;						\
+    } else {								\
+        GLushort *out = (GLushort *) ptrIndexArray;			\
+        __VA_ARGS__;							\
+        ptrIndexArray = out;						\
+    }} while (0)
+
+/* Every primitive mode repeats one short run of indexes, each time some
+   vertexes further on: a triangle strip goes 0,1,2, 2,1,3, then 2,3,4,
+   4,3,5 and so on.  Spread over PATTERN_LEN indexes, a whole number of
+   repeats for every mode, that makes a table; writing the indexes for a
+   block is then adding its first vertex to the table, and storing it and
+   adding the step as often as needed, 8 or 4 indexes at a time with SSE2
+   or NEON.
+ */
+#define PATTERN_LEN	24
+
+enum
+{
+    PATTERN_POINTS,
+    PATTERN_LINES,
+    PATTERN_LINE_STRIP,
+    PATTERN_TRIANGLES,
+    PATTERN_TRIANGLE_STRIP,
+    PATTERN_TRIANGLE_FAN,
+    PATTERN_QUADS,
+    PATTERN_QUAD_STRIP,
+    PATTERNS
+};
+
+static const struct
+{
+    int len;			/* indexes in one repeat */
+    int advance;		/* vertexes it moves on by */
+    GLubyte index[6];
+    GLubyte fixed;		/* bit i: index[i] stays put, like a fan's centre */
+} pattern_units[PATTERNS] = {
+    { 1, 1, { 0 }, 0 },				/* PATTERN_POINTS */
+    { 2, 2, { 0, 1 }, 0 },			/* PATTERN_LINES */
+    { 2, 1, { 0, 1 }, 0 },			/* PATTERN_LINE_STRIP */
+    { 3, 3, { 0, 1, 2 }, 0 },			/* PATTERN_TRIANGLES */
+    { 6, 2, { 0, 1, 2,  2, 1, 3 }, 0 },		/* PATTERN_TRIANGLE_STRIP */
+    { 3, 1, { 0, 1, 2 }, 1 },			/* PATTERN_TRIANGLE_FAN */
+    { 6, 4, { 0, 1, 2,  0, 2, 3 }, 0 },		/* PATTERN_QUADS */
+    { 6, 2, { 0, 1, 3,  0, 3, 2 }, 0 },		/* PATTERN_QUAD_STRIP */
+};
+
+typedef struct
+{
+    GLushort index16[PATTERN_LEN], step16[PATTERN_LEN];
+    GLuint index32[PATTERN_LEN], step32[PATTERN_LEN];
+} index_pattern;
+
+static index_pattern indexPatterns[PATTERNS];
+
+#if defined(__SSE2__)
+# define INDEX_VEC		__m128i
+# define INDEX_VEC_LOAD(p)	_mm_loadu_si128 ((const __m128i *) (p))
+# define INDEX_VEC_STORE(p, v)	_mm_storeu_si128 ((__m128i *) (p), (v))
+# define INDEX_VEC_SPLAT16(x)	_mm_set1_epi16 ((short) (x))
+# define INDEX_VEC_SPLAT32(x)	_mm_set1_epi32 ((int) (x))
+# define INDEX_VEC_ADD16(a, b)	_mm_add_epi16 ((a), (b))
+# define INDEX_VEC_ADD32(a, b)	_mm_add_epi32 ((a), (b))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define INDEX_VEC		uint8x16_t
+# define INDEX_VEC_LOAD(p)	vld1q_u8 ((const uint8_t *) (p))
+# define INDEX_VEC_STORE(p, v)	vst1q_u8 ((uint8_t *) (p), (v))
+# define INDEX_VEC_SPLAT16(x)	vreinterpretq_u8_u16 (vdupq_n_u16 (x))
+# define INDEX_VEC_SPLAT32(x)	vreinterpretq_u8_u32 (vdupq_n_u32 (x))
+# define INDEX_VEC_ADD16(a, b)	vreinterpretq_u8_u16 (			\
+        vaddq_u16 (vreinterpretq_u16_u8 (a), vreinterpretq_u16_u8 (b)))
+# define INDEX_VEC_ADD32(a, b)	vreinterpretq_u8_u32 (			\
+        vaddq_u32 (vreinterpretq_u32_u8 (a), vreinterpretq_u32_u8 (b)))
+#endif
+
+/* The indexes of pattern p for vertexes from `base' on, 32 bits wide
+   if `wide', else 16, one at a time.  Returns the end of what it wrote.
+ */
+static void *
+emit_pattern_scalar (void *out, int p, GLuint base, int count, int wide)
+{
+    const index_pattern *pat = &indexPatterns[p];
+    int g, j;
+
+    if (wide)
+    {
+        GLuint *o = (GLuint *) out;
+        for (g = 0; g + PATTERN_LEN <= count; g += PATTERN_LEN)
+            for (j = 0; j < PATTERN_LEN; j++)
+                o[g + j] = (pat->index32[j] + base +
+                            g / PATTERN_LEN * pat->step32[j]);
+        for (j = 0; g + j < count; j++)
+            o[g + j] = (pat->index32[j] + base +
+                        g / PATTERN_LEN * pat->step32[j]);
+        return o + count;
+    }
+    else
+    {
+        GLushort *o = (GLushort *) out;
+        for (g = 0; g + PATTERN_LEN <= count; g += PATTERN_LEN)
+            for (j = 0; j < PATTERN_LEN; j++)
+                o[g + j] = (pat->index16[j] + base +
+                            g / PATTERN_LEN * pat->step16[j]);
+        for (j = 0; g + j < count; j++)
+            o[g + j] = (pat->index16[j] + base +
+                        g / PATTERN_LEN * pat->step16[j]);
+        return o + count;
+    }
+}
+
+#ifdef INDEX_VEC
+
+/* The same with SSE2 or NEON.  It writes whole tables, so up to
+   PATTERN_LEN - 1 indexes after the end are overwritten with garbage.
+ */
+static void *
+emit_pattern_vec (void *out, int p, GLuint base, int count, int wide)
+{
+    const index_pattern *pat = &indexPatterns[p];
+    int g, j;
+
+    if (wide)
+    {
+        GLuint *o = (GLuint *) out;
+        INDEX_VEC v[PATTERN_LEN / 4], step[PATTERN_LEN / 4];
+        INDEX_VEC b = INDEX_VEC_SPLAT32 (base);
+
+        for (j = 0; j < PATTERN_LEN / 4; j++)
+        {
+            v[j] = INDEX_VEC_ADD32 (INDEX_VEC_LOAD (pat->index32 + j * 4), b);
+            step[j] = INDEX_VEC_LOAD (pat->step32 + j * 4);
+        }
+        for (g = 0; g < count; g += PATTERN_LEN)
+            for (j = 0; j < PATTERN_LEN / 4; j++)
+            {
+                INDEX_VEC_STORE (o + g + j * 4, v[j]);
+                v[j] = INDEX_VEC_ADD32 (v[j], step[j]);
+            }
+        return o + count;
+    }
+    else
+    {
+        GLushort *o = (GLushort *) out;
+        INDEX_VEC v[PATTERN_LEN / 8], step[PATTERN_LEN / 8];
+        INDEX_VEC b = INDEX_VEC_SPLAT16 (base);
+
+        for (j = 0; j < PATTERN_LEN / 8; j++)
+        {
+            v[j] = INDEX_VEC_ADD16 (INDEX_VEC_LOAD (pat->index16 + j * 8), b);
+            step[j] = INDEX_VEC_LOAD (pat->step16 + j * 8);
+        }
+        for (g = 0; g < count; g += PATTERN_LEN)
+            for (j = 0; j < PATTERN_LEN / 8; j++)
+            {
+                INDEX_VEC_STORE (o + g + j * 8, v[j]);
+                v[j] = INDEX_VEC_ADD16 (v[j], step[j]);
+            }
+        return o + count;
+    }
+}
+
+/* Whether emit_pattern_vec gave the same indexes as emit_pattern_scalar
+   for every pattern, both widths and every count up to three tables.
+   Checked once, in index_patterns_init; if it ever doesn't, say with a
+   miscompiled intrinsic, only the scalar one is used.
+ */
+static int patternVecOK = 0;
+
+static int
+index_patterns_check (void)
+{
+    GLuint vec[PATTERN_LEN * 4], ref[PATTERN_LEN * 4];
+    GLuint base[2] = { 7, 70000 };
+    int p, n, wide, b;
+
+    for (p = 0; p < PATTERNS; p++)
+        for (wide = 0; wide < 2; wide++)
+            for (b = 0; b < 2; b++)
+                for (n = 1; n <= 3 * PATTERN_LEN; n++)
+                {
+                    int bytes = n * (wide ? sizeof(GLuint) : sizeof(GLushort));
+                    emit_pattern_vec (vec, p, base[b], n, wide);
+                    emit_pattern_scalar (ref, p, base[b], n, wide);
+                    if (memcmp (vec, ref, bytes))
+                    {
+                        Assert (0, "SIMD index patterns differ from scalar");
+                        return 0;
+                    }
+                }
+    return 1;
+}
+
+#endif /* INDEX_VEC */
+
+/* Write `count' indexes of pattern p, for vertexes from `base' on, of
+   the width in use.  `room' is how many indexes `out' has space for.
+   Returns the end of what it wrote.  The SIMD emitter is only used when
+   there is room for its whole tables; arena_reserve_indexes and
+   quad_ibo_ready leave PATTERN_LEN indexes spare so that it can be.
+ */
+static void *
+emit_pattern (void *out, int room, int p, GLuint base, int count)
+{
+    int wide = (indexType == GL_UNSIGNED_INT);
+
+    Assert (count <= room, "emit_pattern: no room for the indexes");
+#ifdef INDEX_VEC
+    if (patternVecOK &&
+        (count + PATTERN_LEN - 1) / PATTERN_LEN * PATTERN_LEN <= room)
+        return emit_pattern_vec (out, p, base, count, wide);
+#endif
+    return emit_pattern_scalar (out, p, base, count, wide);
+}
+
+static void
+index_patterns_init (void)
+{
+    int p, j;
+
+    for (p = 0; p < PATTERNS; p++)
+        for (j = 0; j < PATTERN_LEN; j++)
+        {
+            int len = pattern_units[p].len;
+            int e = j % len;
+            int fixed = (pattern_units[p].fixed >> e) & 1;
+            GLuint index = (pattern_units[p].index[e] +
+                            (fixed ? 0 : j / len * pattern_units[p].advance));
+            GLuint step = (fixed ? 0 :
+                           PATTERN_LEN / len * pattern_units[p].advance);
+
+            indexPatterns[p].index16[j] = indexPatterns[p].index32[j] = index;
+            indexPatterns[p].step16[j] = indexPatterns[p].step32[j] = step;
+        }
+
+#ifdef INDEX_VEC
+    patternVecOK = index_patterns_check ();
+#endif
+}
+
+static GLuint vertexCount = 0;
+static GLuint indexCount = 0;
+static GLuint vertexMark = 0;
+static int indexbase = 0;
+
+static GLubyte* ptrVertexAttribArrayMark = NULL;
+
+/* currentVertexAttrib and currentVertexPacked are the attributes the
+   next glVertex picks up, in both layouts.  Only the colour of the one
+   in use is kept current.
+ */
+static GLfloat currentNormal[3] = { 0, 0, 1 };
+
+static void* ptrIndexArray = NULL;
+
+/* The indexes of a batch are a sequence of runs, each drawn with one
+   glDrawElements in the order they were submitted.  A new run starts
+   whenever a glBegin block draws something else than the one before:
+   lines and triangles share the batch's vertexes instead of each change
+   between them drawing the batch.
+ */
+typedef struct
+{
+    GLenum mode;		/* GL_TRIANGLES, GL_LINES or GL_POINTS */
+    int first, count;		/* in indexes */
+} batch_run;
+
+static batch_run *batchRuns = NULL;
+static int batchNRuns = 0, batchRunsSize = 0;
+
+/* What the last run draws. */
+static GLenum batchDrawMode = GL_TRIANGLES;
+
+/* A batch of nothing but GL_QUADS has no indexes written for it: it is
+   drawn with quadIbo, which holds 0,1,2, 0,2,3, 4,5,6, 4,6,7... once and
+   for all.  Anything else joining the batch writes them out first.
+ */
+static int batchAllQuads = 1;
+static GLuint quadIbo = 0;
+static int quadIboQuads = 0;		/* how many quads it covers */
+static unsigned long quadBatches = 0;	/* batches drawn with it */
+
+
+static GLubyte* arraysBase = NULL;	/* what the array pointers point at */
+static int vertPtrSize = 0;		/* components glVertexPointer got */
+
+
+/* The arrays handed to glVertexPointer etc. point into the arena, so
+   any time it moves they must be set again at the next flush.
+ */
+static void
+arena_moved (void)
+{
+    int end = (arena.vert_bytes / vertStride < maxBatchVerts ?
+               arena.vert_bytes / vertStride : maxBatchVerts);
+    ptrVertexAttribArrayEnd = arena.verts + end * vertStride;
+    jwzgles_cursor.start = arena.verts;
+
+    state->vertPrtValid = 0;
+    state->colorPtrValid = 0;
+    state->texPrtValid = 0;
+    state->normPtrValid = 0;
+}
+
+static void
+arena_init (void)
+{
+    const char *ext = (const char *) glGetString (GL_EXTENSIONS);
+
+    if (ext && strstr (ext, "GL_OES_element_index_uint"))
+    {
+        indexType = GL_UNSIGNED_INT;
+        indexBytes = sizeof(GLuint);
+        maxBatchVerts = 0x7FFFFFFF;
+    }
+    if (batchVertsCap && batchVertsCap < maxBatchVerts)
+        maxBatchVerts = batchVertsCap;
+    haveMapBuffer = (ext && strstr (ext, "GL_OES_mapbuffer") != 0);
+    index_patterns_init ();
+    havePointSizeArray = (ext && strstr (ext, "GL_OES_point_size_array") != 0);
+
+    arena.vert_bytes = ARENA_MIN_VERT_BYTES;
+    arena.index_size = ARENA_MIN_INDEXES;
+    arena.verts   = (GLubyte *) malloc (arena.vert_bytes);
+    arena.indexes = malloc (arena.index_size * indexBytes);
+    Assert (arena.verts && arena.indexes, "out of memory");
+    if (!arena.verts || !arena.indexes)
+    {
+        /* No room for a vertex, so none are taken until the next
+           glBegin tries again. */
+        free (arena.verts);
+        free (arena.indexes);
+        arena.verts = 0;
+        arena.indexes = 0;
+        arena.vert_bytes = arena.index_size = 0;
+    }
+    if (!arena.shrink_frames)
+        arena.shrink_frames = ARENA_SHRINK_FRAMES;
+    arena_moved ();
+
+    /* Until now the colour went into the float layout. */
+    set_vertex_layout (compactWanted, batchNormals, batchTexCoords);
+    vertex_offsets ();
+}
+
+/* Double the room for vertexes.  Returns 0 if out of memory.
+ */
+static int
+arena_grow_verts (void)
+{
+    int used = ptrVertexAttribArray - arena.verts;
+    int mark = ptrVertexAttribArrayMark - arena.verts;
+    int new_bytes = arena.vert_bytes * 2;
+    GLubyte *verts = (GLubyte *) realloc (arena.verts, new_bytes);
+
+    Assert (verts, "out of memory");
+    if (!verts) return 0;
+
+    LOGI ("batch arena: %d -> %d vertex bytes", arena.vert_bytes, new_bytes);
+
+    ptrVertexAttribArray = verts + used;
+    ptrVertexAttribArrayMark = verts + mark;
+    arena.verts = verts;
+    arena.vert_bytes = new_bytes;
+    arena_moved ();
+    return 1;
+}
+
+/* Make sure there is room for another `count' indexes, and the slack
+   emit_pattern needs after them.  Returns 0 if out of memory.
+ */
+static int
+arena_reserve_indexes (int count)
+{
+    int used = INDEXES_USED();
+    int new_size = arena.index_size;
+    void *indexes;
+
+    count += PATTERN_LEN;
+    if (used + count <= arena.index_size)
+        return 1;
+    if (!arena.indexes)
+        return 0;
+
+    while (used + count > new_size)
+        new_size *= 2;
+
+    indexes = realloc (arena.indexes, new_size * indexBytes);
+    Assert (indexes, "out of memory");
+    if (!indexes) return 0;
+
+    LOGI ("batch arena: %d -> %d indexes", arena.index_size, new_size);
+
+    ptrIndexArray = (GLubyte *) indexes + used * indexBytes;
+    arena.indexes = indexes;
+    arena.index_size = new_size;
+    return 1;
+}
+
+/* Called with the batch that is about to be drawn, to track how much
+   of the arena is actually being used.
+ */
+static void
+arena_note_usage (void)
+{
+    int bytes   = ptrVertexAttribArray - arena.verts;
+    int verts   = VERT_COUNT (arena.verts, ptrVertexAttribArray);
+    int indexes = INDEXES_USED();
+
+    if (bytes > arena.vert_peak)     arena.vert_peak = bytes;
+    if (indexes > arena.index_peak)  arena.index_peak = indexes;
+    if (verts > arena.vert_hwm)      arena.vert_hwm = verts;
+    if (indexes > arena.index_hwm)   arena.index_hwm = indexes;
+}
+
+/* Reallocate one of the arena arrays down to the smallest power of 2
+   that holds twice the recent peak.
+ */
+static void *
+arena_shrink_array (void *array, int *size, int peak, int min, int span)
+{
+    int new_size = min;
+    void *a;
+
+    while (new_size < peak * 2)
+        new_size *= 2;
+    if (new_size >= *size)
+        return array;
+
+    a = realloc (array, new_size * span);
+    if (!a) return array;	/* keep the bigger one, then */
+    *size = new_size;
+    return a;
+}
+
+/* Once per frame: if the arena has been less than a quarter full for
+   long enough, give the memory back.  Only called with an empty batch.
+ */
+static void
+arena_end_frame (void)
+{
+    if (!arena.verts)
+        return;
+
+    if (arena.vert_peak * 4 <= arena.vert_bytes &&
+        arena.index_peak * 4 <= arena.index_size)
+        arena.quiet_frames++;
+    else
+        arena.quiet_frames = 0;
+
+    if (arena.shrink_frames > 0 && arena.quiet_frames >= arena.shrink_frames)
+    {
+        LOGI ("batch arena: shrinking %d vertex bytes, %d indexes"
+              " (peak %d, %d)",
+              arena.vert_bytes, arena.index_size,
+              arena.vert_peak, arena.index_peak);
+
+        arena.verts = (GLubyte *)
+            arena_shrink_array (arena.verts, &arena.vert_bytes,
+                                arena.vert_peak, ARENA_MIN_VERT_BYTES, 1);
+        arena.indexes =
+            arena_shrink_array (arena.indexes, &arena.index_size,
+                                arena.index_peak, ARENA_MIN_INDEXES,
+                                indexBytes);
+        ptrVertexAttribArray = arena.verts;
+        ptrVertexAttribArrayMark = ptrVertexAttribArray;
+        ptrIndexArray = arena.indexes;
+        arena_moved ();
+        arena.quiet_frames = 0;
+    }
+
+    arena.vert_peak = 0;
+    arena.index_peak = 0;
+}
+
+
+/* Whether the batch's vertexes may not all be in the first one's
+   colour.
+ */
+#define BATCH_RECOLORED() (batchRecolored &&				\
+        batchRecolored < VERT_COUNT (arena.verts, ptrVertexAttribArray))
+
+static void
+reset_batch (void)
+{
+    vertexCount = 0;
+    indexCount = 0;
+    vertexMark = 0;
+    indexbase = 0;
+    ptrVertexAttribArray = arena.verts;
+    ptrVertexAttribArrayMark = ptrVertexAttribArray;
+    ptrIndexArray = arena.indexes;
+    useTexCoordArray = GL_FALSE;
+    batchAllQuads = 1;
+    batchNRuns = 0;
+    batchRecolored = 0;
+    batchHasZ = 0;
+}
+
+/* Start a run of `mode' at the next index.  Returns 0 if out of memory.
+ */
+static int
+batch_new_run (GLenum mode)
+{
+    if (batchNRuns == batchRunsSize)
+    {
+        int size = (batchRunsSize ? batchRunsSize * 2 : 16);
+        batch_run *runs = (batch_run *)
+            realloc (batchRuns, size * sizeof(*runs));
+        Assert (runs, "out of memory");
+        if (!runs)
+            return 0;
+        batchRuns = runs;
+        batchRunsSize = size;
+    }
+
+    batchRuns[batchNRuns].mode = mode;
+    batchRuns[batchNRuns].first = INDEXES_USED();
+    batchRuns[batchNRuns].count = 0;
+    batchNRuns++;
+    batchDrawMode = mode;
+    return 1;
+}
+
+/* Write the indexes for quads made of vertexes first to first+n.
+   Returns 0 if out of memory.
+ */
+static int
+emit_quad_indexes (int first, int n)
+{
+    if (!arena_reserve_indexes (n / 4 * 6))
+        return 0;
+    ptrIndexArray = emit_pattern (ptrIndexArray, INDEXES_ROOM(),
+                                  PATTERN_QUADS, first, n / 4 * 6);
+    return 1;
+}
+
+/* The batch is about to need real indexes for the quads it has.
+   Returns 0 if there was no room for them; the batch is left as it was.
+ */
+static int
+batch_quad_indexes (void)
+{
+    if (!batchAllQuads)
+        return 1;
+    if (!emit_quad_indexes (0, indexCount))
+        return 0;
+    batchAllQuads = 0;
+    return 1;
+}
+
+/* Make sure quadIbo covers this many quads.  Returns 0 if it can't.
+ */
+static int
+quad_ibo_ready (int quads)
+{
+    int size;
+    void *indexes;
+
+    if (quads <= quadIboQuads)
+        return 1;
+
+    size = (quadIboQuads ? quadIboQuads : ARENA_MIN_VERTS / 4);
+    while (size < quads)
+        size *= 2;
+    if (size > maxBatchVerts / 4)
+        size = maxBatchVerts / 4;
+    if (size < quads)
+        return 0;
+
+    if (!quadIbo)
+        glGenBuffers (1, &quadIbo);
+    if (!quadIbo)
+        return 0;
+
+    indexes = malloc ((size * 6 + PATTERN_LEN) * indexBytes);
+    if (!indexes)
+        return 0;
+
+    emit_pattern (indexes, size * 6 + PATTERN_LEN, PATTERN_QUADS, 0,
+                  size * 6);
+
+    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, quadIbo);
+    glBufferData (GL_ELEMENT_ARRAY_BUFFER, size * 6 * indexBytes, indexes,
+                  GL_STATIC_DRAW);
+    glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    CHECK("quad_ibo_ready");
+    free (indexes);
+
+    quadIboQuads = size;
+    return 1;
+}
+
+
+/* With JWZGLES_VBO_RING set to N, each batch is copied into the next of
+   N buffer objects and drawn from there, instead of from client memory
+   that the driver would copy again on every draw.  The old contents are
+   orphaned first, so the copy doesn't wait for draws still reading them.
+ */
+#define RING_MAX	8
+
+static int ringCount = 0;		/* 0 = draw from client memory */
+static GLuint ringVbo[RING_MAX];
+static int ringBytes[RING_MAX];		/* allocated size of each */
+static int ringNext = 0;
+static unsigned long ringUploaded = 0;	/* bytes */
+
+static void
+ring_resize (int count)
+{
+    int i;
+
+    if (count < 0) count = 0;
+    if (count > RING_MAX) count = RING_MAX;
+
+    for (i = count; i < RING_MAX; i++)
+        if (ringVbo[i])
+        {
+            glDeleteBuffers (1, &ringVbo[i]);
+            ringVbo[i] = 0;
+            ringBytes[i] = 0;
+        }
+
+    ringCount = count;
+    ringNext = 0;
+}
+
+
+/* With JWZGLES_BATCH_CACHE set to N bytes, batches that come round again
+   unchanged, like a HUD or a menu redrawn every frame, are drawn from
+   buffer objects kept from the last time instead of being sent again.
+   A batch is known by a hash of its vertexes, indexes and layout; the
+   second time one turns up it is uploaded and kept, so geometry that
+   changes every frame only costs the hash.  Hashes seen once so far go
+   in a table of their own, so they never push out a kept batch.  Kept
+   batches are let go when not drawn for a while, or least recently
+   drawn first to stay within N bytes; those drawn this frame are never
+   traded for new ones, so a frame with more batches than there are
+   slots keeps hitting on the ones it has.
+ */
+#define CACHE_SLOTS	64
+#define CACHE_SEEN	256		/* a power of 2 */
+#define CACHE_MAX_AGE	60		/* frames */
+
+typedef struct
+{
+    uint64_t hash;		/* 0 = free */
+    int bytes;			/* vertexes and indexes */
+    GLuint vbo, ibo;
+    unsigned long used;		/* cacheFrame when last drawn */
+} cache_slot;
+
+static cache_slot cacheSlots[CACHE_SLOTS];
+static uint64_t cacheSeen[CACHE_SEEN];	/* hashes seen once; 0 = none */
+static int cacheBudget = 0;		/* 0 = off */
+static int cacheBytes = 0;		/* in buffers now */
+static unsigned long cacheFrame = 1;
+static unsigned long cacheHits = 0;
+
+/* Four lanes of multiply and xor-shift, so that one doesn't wait on the
+   last.  Not for security: it only has to tell batches apart.
+ */
+static uint64_t
+hash_bytes (uint64_t seed, const GLubyte *p, int bytes)
+{
+    static const uint64_t k = 0x9E3779B97F4A7C15ULL;
+    uint64_t h[4], w;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        h[i] = seed + i * k;
+
+    for (; bytes >= 32; bytes -= 32, p += 32)
+        for (i = 0; i < 4; i++)
+        {
+            memcpy (&w, p + i * 8, 8);
+            h[i] = (h[i] ^ w) * k;
+            h[i] ^= h[i] >> 29;
+        }
+    for (i = 0; bytes > 0; bytes -= 8, p += 8, i = (i + 1) & 3)
+    {
+        w = 0;
+        memcpy (&w, p, (bytes < 8 ? bytes : 8));
+        h[i] = (h[i] ^ w) * k;
+        h[i] ^= h[i] >> 29;
+    }
+
+    w = h[0] ^ (h[1] * 3) ^ (h[2] * 5) ^ (h[3] * 7);
+    w ^= w >> 31;
+    w *= k;
+    w ^= w >> 32;
+    return (w ? w : 1);
+}
+
+static void
+cache_drop (cache_slot *c)
+{
+    if (c->vbo)
+        glDeleteBuffers (1, &c->vbo);
+    if (c->ibo)
+        glDeleteBuffers (1, &c->ibo);
+    if (c->vbo)
+        cacheBytes -= c->bytes;
+    memset (c, 0, sizeof(*c));
+}
+
+static void
+cache_resize (int budget)
+{
+    int i;
+
+    cacheBudget = (budget > 0 ? budget : 0);
+    if (!cacheBudget)
+    {
+        for (i = 0; i < CACHE_SLOTS; i++)
+            cache_drop (&cacheSlots[i]);
+        memset (cacheSeen, 0, sizeof(cacheSeen));
+    }
+
+    /* Least recently drawn first. */
+    while (cacheBytes > cacheBudget)
+    {
+        cache_slot *old = 0;
+        for (i = 0; i < CACHE_SLOTS; i++)
+            if (cacheSlots[i].vbo &&
+                (!old || cacheSlots[i].used < old->used))
+                old = &cacheSlots[i];
+        if (!old)
+            break;
+        cache_drop (old);
+    }
+}
+
+/* Find or make the buffers for this batch.  Returns the slot to draw
+   from, with its buffers bound, or 0 to draw it as usual.
+ */
+static cache_slot *
+cache_batch (const GLubyte *verts, int nverts, const void *indexes,
+             const batch_run *runs, int nruns)
+{
+    int vbytes = nverts * vertStride;
+    int ibytes = (indexes && nruns
+                  ? (runs[nruns-1].first + runs[nruns-1].count) * indexBytes
+                  : 0);
+    uint64_t layout = (vertStride | (compactVerts << 8) |
+                       (batchTexCoords << 9) | (batchMulti << 10) |
+                       (batchNormals << 11) | (batchPointSizes << 12) |
+                       ((uint64_t) indexBytes << 16) |
+                       ((uint64_t) ibytes << 32));
+    uint64_t hash, *seen;
+    cache_slot *c = 0, *victim = 0;
+    int i;
+
+    if (vbytes + ibytes > cacheBudget / 4)
+        return 0;		/* would push out too much */
+
+    hash = hash_bytes (layout, verts, vbytes);
+    if (ibytes)
+        hash = hash_bytes (hash, (const GLubyte *) indexes, ibytes);
+
+    for (i = 0; i < CACHE_SLOTS; i++)
+    {
+        c = &cacheSlots[i];
+        if (c->hash == hash)
+        {
+            c->used = cacheFrame;
+            glBindBuffer (GL_ARRAY_BUFFER, c->vbo);
+            if (c->ibo)
+                glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, c->ibo);
+            cacheHits++;
+            return c;
+        }
+
+        /* A free slot, or else the one drawn longest ago. */
+        if (!c->hash)
+        {
+            if (!victim || victim->hash)
+                victim = c;
+        }
+        else if (c->used != cacheFrame &&
+                 (!victim || (victim->hash && c->used < victim->used)))
+            victim = c;
+    }
+
+    seen = &cacheSeen[hash & (CACHE_SEEN - 1)];
+    if (*seen != hash)		/* first time: just remember it */
+    {
+        *seen = hash;
+        return 0;
+    }
+    if (!victim)		/* all drawn this frame: try next frame */
+        return 0;
+
+    /* Second time: keep it. */
+    *seen = 0;
+    c = victim;
+    cache_drop (c);
+    glGenBuffers (1, &c->vbo);
+    if (ibytes)
+        glGenBuffers (1, &c->ibo);
+    if (!c->vbo || (ibytes && !c->ibo))
+    {
+        cache_drop (c);
+        return 0;
+    }
+    c->hash = hash;
+    c->bytes = vbytes + ibytes;
+    cacheBytes += c->bytes;
+
+    glBindBuffer (GL_ARRAY_BUFFER, c->vbo);
+    glBufferData (GL_ARRAY_BUFFER, vbytes, verts, GL_STATIC_DRAW);
+    if (ibytes)
+    {
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, c->ibo);
+        glBufferData (GL_ELEMENT_ARRAY_BUFFER, ibytes, indexes,
+                      GL_STATIC_DRAW);
+    }
+    CHECK("cache_batch");
+
+    /* Make room for it, without letting go of it. */
+    c->used = (unsigned long) -1;
+    cache_resize (cacheBudget);
+    c->used = cacheFrame;
+    return c;
+}
+
+/* Once per frame: let go of batches that haven't been drawn lately. */
+static void
+cache_end_frame (void)
+{
+    int i;
+
+    for (i = 0; i < CACHE_SLOTS; i++)
+        if (cacheSlots[i].hash &&
+            cacheFrame - cacheSlots[i].used >= CACHE_MAX_AGE)
+            cache_drop (&cacheSlots[i]);
+    cacheFrame++;
+}
+
+
+/* Copy the vertexes into the next buffer of the ring and leave it bound
+   to GL_ARRAY_BUFFER.  Returns 0 if the batch has to be drawn from
+   client memory after all.
+ */
+static int
+ring_upload (const GLubyte *verts, int bytes)
+{
+    int i = ringNext;
+
+    ringNext = (ringNext + 1) % ringCount;
+
+    if (!ringVbo[i])
+        glGenBuffers (1, &ringVbo[i]);
+    if (!ringVbo[i])
+        return 0;
+
+    glBindBuffer (GL_ARRAY_BUFFER, ringVbo[i]);
+
+    if (ringBytes[i] < bytes)
+    {
+        int size = (ringBytes[i] ? ringBytes[i] :
+                    ARENA_MIN_VERTS * (int) sizeof(VertexAttrib));
+        while (size < bytes)
+            size *= 2;
+        ringBytes[i] = size;
+    }
+
+    glBufferData (GL_ARRAY_BUFFER, ringBytes[i], NULL, GL_DYNAMIC_DRAW);
+    ringUploaded += bytes;
+
+    if (haveMapBuffer)
+    {
+        void *p = glMapBufferOES (GL_ARRAY_BUFFER, GL_WRITE_ONLY_OES);
+        if (p)
+        {
+            memcpy (p, verts, bytes);
+            if (glUnmapBufferOES (GL_ARRAY_BUFFER))
+                return 1;
+            /* else the contents were lost; send them again */
+        }
+    }
+
+    glBufferSubData (GL_ARRAY_BUFFER, 0, bytes, verts);
+    CHECK("ring_upload");
+    return 1;
+}
+
+
+static unsigned long constColorBatches = 0;
+static unsigned long flatBatches = 0;
+/* Set the driver's current colour to the one at c, in the layout's
+   colour type.
+ */
+static void
+send_color (const GLubyte *c)
+{
+    if (compactVerts)
+        glColor4ub (c[0], c[1], c[2], c[3]);
+    else
+    {
+        const GLfloat *f = (const GLfloat *) c;
+        glColor4f (f[0], f[1], f[2], f[3]);
+    }
+}
+
+/* Draw the runs of indexes from one set of `nverts' vertexes: the
+   arena, or a bucket of the sort queue.  No indexes means use quadIbo.
+   Unless `colors' says they may differ, the vertexes all have the
+   first one's colour, and the batch is drawn with glColor instead of
+   the colour array.  Unless `has_z', they all have z = 0, as from
+   glVertex2* and glRect*, and the driver is only given x and y.
+ */
+static void
+draw_batch (GLubyte *verts, int nverts, const void *indexes,
+            const batch_run *runs, int nruns, int colors, int has_z)
+{
+    const GLubyte *color = verts + vertColorOffset;
+    int texcoords = batchTexCoords;
+    int size = (has_z ? 3 : 2);
+    int quads = !indexes;	/* drawn with quadIbo */
+    GLuint ibo = 0;		/* a cached batch's indexes */
+    cache_slot *cached;
+    int i;
+
+    LOGI("draw_batch drawing %d runs", nruns);
+
+    if (!has_z)
+        flatBatches++;
+
+    state->appArraysLost = 1;
+
+    /* The pointers are only still valid if they point at these. */
+    if (verts != arraysBase)
+    {
+        state->vertPrtValid = 0;
+        state->colorPtrValid = 0;
+        state->texPrtValid = 0;
+        state->normPtrValid = 0;
+        arraysBase = verts;
+    }
+
+    glClientActiveTexture(GL_TEXTURE0);
+
+    /* The app's buffers are bound again afterwards. */
+    if( state->element_array_buffer != 0 )
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    if( state->array_buffer != 0 )
+        glBindBuffer (GL_ARRAY_BUFFER, 0);
+
+    cached = (cacheBudget
+              ? cache_batch (verts, nverts, indexes, runs, nruns) : 0);
+    if (cached)
+    {
+        /* The pointers become offsets into its buffers, and the
+           indexes too unless they are quadIbo's.
+         */
+        verts = 0;
+        if (!quads)
+        {
+            indexes = 0;
+            ibo = cached->ibo;
+        }
+        state->vertPrtValid = 0;
+        state->colorPtrValid = 0;
+        state->texPrtValid = 0;
+        state->normPtrValid = 0;
+    }
+    else if (ringCount && ring_upload (verts, nverts * vertStride))
+    {
+        /* The pointers become offsets into the ring buffer. */
+        verts = 0;
+        state->vertPrtValid = 0;
+        state->colorPtrValid = 0;
+        state->texPrtValid = 0;
+        state->normPtrValid = 0;
+    }
+
+    if( !state->colorPtrValid )
+    {
+        glColorPointer(4, vertColorType, vertStride, verts + vertColorOffset);
+        state->colorPtrValid = 1;
+    }
+
+    if( texcoords && !state->texPrtValid )
+    {
+        glTexCoordPointer(2, GL_FLOAT, vertStride, verts + vertTexOffset);
+        state->texPrtValid = 1;
+    }
+
+    if( batchNormals && !state->normPtrValid )
+    {
+        glNormalPointer(GL_BYTE, vertStride, verts + vertNormalOffset);
+        state->normPtrValid = 1;
+    }
+
+    if( !(state->enabled & ISENABLED_VERT_ARRAY) )
+    {
+        glEnableClientState(GL_VERTEX_ARRAY);
+    }
+
+    /* The arrays the batch doesn't use are turned off for it, even
+       if the app has them on.
+     */
+    if( texcoords != !!(state->enabled & ISENABLED_TEX_ARRAY) )
+    {
+        if (texcoords)
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        else
+            glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    }
+
+    if( colors != !!(state->enabled & ISENABLED_COLOR_ARRAY) )
+    {
+        if (colors)
+            glEnableClientState(GL_COLOR_ARRAY);
+        else
+            glDisableClientState(GL_COLOR_ARRAY);
+    }
+
+    if (!colors)
+    {
+        send_color (color);
+        constColorBatches++;
+    }
+
+    if( batchNormals && !(state->enabled & ISENABLED_NORM_ARRAY) )
+    {
+        glEnableClientState(GL_NORMAL_ARRAY);
+    }
+
+    if (batchMulti)
+    {
+        glClientActiveTexture(GL_TEXTURE1);
+
+        glTexCoordPointer(2, GL_FLOAT, vertStride,
+                          verts + vertTexMultiOffset);
+
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+        glClientActiveTexture(GL_TEXTURE0);
+    }
+
+    if (batchPointSizes)
+    {
+        glPointSizePointerOES(GL_FLOAT, vertStride,
+                              verts + vertPointSizeOffset);
+        glEnableClientState(GL_POINT_SIZE_ARRAY_OES);
+    }
+
+    if (quads)
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, quadIbo);
+
+    if( !state->vertPrtValid || size != vertPtrSize )
+    {
+        glVertexPointer(size, GL_FLOAT, vertStride, verts);
+        vertPtrSize = size;
+        state->vertPrtValid = 1;
+    }
+
+    for (i = 0; i < nruns; i++)
+        glDrawElements( runs[i].mode, runs[i].count, indexType,
+                        (GLubyte *) indexes + runs[i].first * indexBytes );
+
+    if (quads || ibo)
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+
+
+    if( !(state->enabled & ISENABLED_VERT_ARRAY) )
+    {
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+
+    if( texcoords != !!(state->enabled & ISENABLED_TEX_ARRAY) )
+    {
+        if (texcoords)
+            glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        else
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    }
+
+    if( colors != !!(state->enabled & ISENABLED_COLOR_ARRAY) )
+    {
+        if (colors)
+            glDisableClientState(GL_COLOR_ARRAY);
+        else
+            glEnableClientState(GL_COLOR_ARRAY);
+    }
+
+    /* Back to the app's current colour. */
+    if (!colors)
+        send_color (compactVerts
+                    ? (const GLubyte *) &currentVertexPacked.red
+                    : (const GLubyte *) &currentVertexAttrib.red);
+
+    if( batchNormals && !(state->enabled & ISENABLED_NORM_ARRAY) )
+    {
+        /* The current normal is undefined after drawing with the array. */
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glNormal3f (currentNormal[0], currentNormal[1], currentNormal[2]);
+    }
+
+    if (batchMulti)
+    {
+        glClientActiveTexture(GL_TEXTURE1);
+        if (!(state->otherTexArrays & 2))
+            glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glClientActiveTexture(GL_TEXTURE0);
+        glMultiTexCoord4f (GL_TEXTURE1, currentVertexPacked.s_multi,
+                           currentVertexPacked.t_multi, 0, 1);
+    }
+
+    if (batchPointSizes)
+        glDisableClientState(GL_POINT_SIZE_ARRAY_OES);
+
+    if (!verts)		/* drew from the ring or the cache */
+    {
+        glBindBuffer (GL_ARRAY_BUFFER, 0);
+        state->vertPrtValid = 0;
+        state->colorPtrValid = 0;
+        state->texPrtValid = 0;
+        state->normPtrValid = 0;
+        arraysBase = NULL;
+    }
+
+    if( state->element_array_buffer != 0 )
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, state->element_array_buffer);
+
+    if( state->array_buffer != 0 )
+        glBindBuffer (GL_ARRAY_BUFFER, state->array_buffer);
+
+    if (state->client_texture != GL_TEXTURE0)
+        glClientActiveTexture (state->client_texture);
+}
+
+
+/* With JWZGLES_SORT_BY_TEXTURE on, a batch that is only being flushed
+   because the texture changes goes into a bucket for its texture
+   instead of being drawn.  The buckets are drawn, one glDrawElements
+   each, at the next flush for any other reason (a state or matrix
+   change, glFlush, glFinish, jwzgles_end_frame...), so everything in
+   them was built under the same state except for the texture.
+
+   That reorders the draws, so it is only done while depth testing is
+   on and blending is off.
+ */
+#define SORT_BUCKETS	64
+
+typedef struct
+{
+    GLuint texture;
+    GLenum mode;		/* batchDrawMode */
+    GLubyte *verts;		/* vertStride bytes each */
+    int nverts, vert_bytes;
+    void *indexes;		/* indexBytes each */
+    int nindexes, index_size;
+    int colors;			/* not all in the first vertex's colour */
+    int has_z;			/* some vertex has z != 0 */
+} sort_bucket;
+
+static int sortByTexture = 0;
+static sort_bucket sortBuckets[SORT_BUCKETS];
+static int sortNBuckets = 0;		/* holding something */
+static unsigned long sortQueued = 0;	/* batches put in a bucket */
+
+static int
+sort_allowed (void)
+{
+    return ((enabled_applied & ISENABLED_DEPTH_TEST) &&
+            !(enabled_applied & ISENABLED_BLEND) &&
+            shadow_active_texture == GL_TEXTURE0 &&
+            (restore_state.target == GL_TEXTURE_2D ||
+             restore_state.target == GL_TEXTURE_1D));
+}
+
+/* Move the batch into the bucket for the bound texture.  Returns 0 if
+   it has to be drawn the usual way.
+ */
+static int
+defer_batch (void)
+{
+    int nverts = VERT_COUNT (arena.verts, ptrVertexAttribArray);
+    int nindexes;
+    sort_bucket *b = 0;
+    int i;
+
+    if (batchNRuns != 1)	/* buckets hold one kind of primitive */
+        return 0;
+
+    if (!batch_quad_indexes ())
+        return 0;
+    nindexes = INDEXES_USED();
+
+    for (i = 0; i < sortNBuckets; i++)
+        if (sortBuckets[i].texture == restore_state.texture &&
+            sortBuckets[i].mode == batchDrawMode)
+        {
+            b = &sortBuckets[i];
+            break;
+        }
+
+    if (!b)
+    {
+        if (sortNBuckets == SORT_BUCKETS)
+            return 0;
+        b = &sortBuckets[sortNBuckets++];
+        b->texture = restore_state.texture;
+        b->mode = batchDrawMode;
+        b->nverts = 0;
+        b->nindexes = 0;
+    }
+
+    if (b->nverts + nverts > maxBatchVerts)
+        return 0;
+
+    if ((b->nverts + nverts) * vertStride > b->vert_bytes)
+    {
+        int size = (b->vert_bytes ? b->vert_bytes
+                    : ARENA_MIN_VERTS * vertStride);
+        GLubyte *verts;
+        while (size < (b->nverts + nverts) * vertStride)
+            size *= 2;
+        verts = (GLubyte *) realloc (b->verts, size);
+        if (!verts) return 0;
+        b->verts = verts;
+        b->vert_bytes = size;
+    }
+
+    if (b->nindexes + nindexes > b->index_size)
+    {
+        int size = (b->index_size ? b->index_size : ARENA_MIN_INDEXES);
+        void *indexes;
+        while (size < b->nindexes + nindexes)
+            size *= 2;
+        indexes = realloc (b->indexes, size * indexBytes);
+        if (!indexes) return 0;
+        b->indexes = indexes;
+        b->index_size = size;
+    }
+
+    if (!b->nverts)
+    {
+        b->colors = BATCH_RECOLORED();
+        b->has_z = batchHasZ;
+    }
+    else
+    {
+        if (!b->colors)
+            b->colors = (BATCH_RECOLORED() ||
+                         memcmp (b->verts + vertColorOffset,
+                                 arena.verts + vertColorOffset,
+                                 (compactVerts ? 4 : 4 * sizeof(GLfloat))));
+        b->has_z |= batchHasZ;
+    }
+    memcpy (b->verts + b->nverts * vertStride, arena.verts,
+            nverts * vertStride);
+
+    if (indexType == GL_UNSIGNED_INT)
+    {
+        const GLuint *in = (const GLuint *) arena.indexes;
+        GLuint *out = (GLuint *) b->indexes + b->nindexes;
+        for (i = 0; i < nindexes; i++)
+            out[i] = in[i] + b->nverts;
+    }
+    else
+    {
+        const GLushort *in = (const GLushort *) arena.indexes;
+        GLushort *out = (GLushort *) b->indexes + b->nindexes;
+        for (i = 0; i < nindexes; i++)
+            out[i] = in[i] + b->nverts;
+    }
+
+    b->nverts += nverts;
+    b->nindexes += nindexes;
+    sortQueued++;
+
+    arena_note_usage ();
+    reset_batch ();
+    return 1;
+}
+
+static int
+sort_bucket_cmp (const void *a, const void *b)
+{
+    const sort_bucket *ba = (const sort_bucket *) a;
+    const sort_bucket *bb = (const sort_bucket *) b;
+    if (ba->texture != bb->texture)
+        return (ba->texture < bb->texture ? -1 : 1);
+    return (int) ba->mode - (int) bb->mode;
+}
+
+/* Draw every bucket, then put back the texture binding the app has.
+ */
+static void
+drain_buckets (void)
+{
+    GLuint bound = SHADOW_UNKNOWN;
+    int i;
+
+    qsort (sortBuckets, sortNBuckets, sizeof(*sortBuckets), sort_bucket_cmp);
+
+    for (i = 0; i < sortNBuckets; i++)
+    {
+        sort_bucket *b = &sortBuckets[i];
+        batch_run run;
+
+        if (b->texture != bound)
+        {
+            glBindTexture (GL_TEXTURE_2D, b->texture);
+            bound = b->texture;
+        }
+        run.mode = b->mode;
+        run.first = 0;
+        run.count = b->nindexes;
+        draw_batch (b->verts, b->nverts, b->indexes, &run, 1,
+                    b->colors, b->has_z);
+        b->nverts = 0;
+        b->nindexes = 0;
+    }
+    sortNBuckets = 0;
+
+    if (bound != restore_state.texture)
+        glBindTexture (GL_TEXTURE_2D, restore_state.texture);
+}
+
+/* Give back the buckets' memory once sorting is turned off. */
+static void
+free_buckets (void)
+{
+    int i;
+    for (i = 0; i < SORT_BUCKETS; i++)
+    {
+        free (sortBuckets[i].verts);
+        free (sortBuckets[i].indexes);
+        memset (&sortBuckets[i], 0, sizeof(sortBuckets[i]));
+    }
+    sortNBuckets = 0;
+}
+
+
+void FlushOnStateChange()
+{
+    if (sortNBuckets)
+    {
+        /* The batch may as well share a draw with its bucket. */
+        if (vertexCount && sort_allowed ())
+            defer_batch ();
+        drain_buckets ();
+    }
+
+    if (!vertexCount)
+        return;
+
+    if (batchAllQuads)
+    {
+        if (quad_ibo_ready (vertexCount / 6))
+            quadBatches++;
+        else if (!batch_quad_indexes ())
+        {
+            reset_batch ();	/* can't be drawn */
+            return;
+        }
+    }
+
+    arena_note_usage ();
+    draw_batch (arena.verts, VERT_COUNT (arena.verts, ptrVertexAttribArray),
+                batchAllQuads ? NULL : arena.indexes,
+                batchRuns, batchNRuns, BATCH_RECOLORED(), batchHasZ);
+    reset_batch ();
+}
+
+/* Called by glBindTexture before the binding changes. */
+void FlushOnTextureChange()
+{
+    if (sortByTexture && vertexCount && sort_allowed () && defer_batch ())
+        return;
+    FlushOnStateChange();
+}
+
+void
+jwzgles_glBegin_OVERRIDE(int mode)
+{
+    wrapperPrimitiveMode = mode;
+}
+
+/* Draw the primitives completed before the current glBegin, and move
+   the vertexes of the one in progress to the front of the arena.
+ */
+static void
+split_batch (void)
+{
+    int bytes = ptrVertexAttribArray - ptrVertexAttribArrayMark;
+    GLubyte *block = ptrVertexAttribArrayMark;
+    int mark = VERT_COUNT (arena.verts, block);
+    int recolored = batchRecolored, has_z = batchHasZ;
+
+    ptrVertexAttribArray = ptrVertexAttribArrayMark;
+    FlushOnStateChange();
+    reset_batch ();
+
+    memmove (arena.verts, block, bytes);
+    ptrVertexAttribArray = arena.verts + bytes;
+    if (recolored)	/* counted from the new first vertex */
+        batchRecolored = (recolored > mark ? recolored - mark : 1);
+    batchHasZ = has_z;
+    batchSplits++;
+}
+
+/* The vertex about to be written does not fit.  Grow the arena, or if
+   the batch already holds as many vertexes as it may (as many as an
+   index can address, or JWZGLES_BATCH_VERTS), start a new batch with the
+   primitive in progress, or with what is left of it if that is all the
+   batch holds.  Returns 0 if the vertex has to be dropped.
+ */
+static int
+batch_make_room (void)
+{
+    if (VERT_COUNT (arena.verts, ptrVertexAttribArray) < maxBatchVerts)
+        return (arena.verts && arena_grow_verts ());
+
+    if (ptrVertexAttribArrayMark > arena.verts)
+    {
+        split_batch ();
+        return 1;
+    }
+
+    if (glBegin_active && split_block ())
+        return 1;
+
+    Assert (0, "glBegin block too big for 16 bit indexes");
+    return 0;
+}
+
+
+/* Lines and points can be turned into quads that go in with the
+   triangles, as big on the screen as the driver would draw them.  That
+   needs the matrixes and the viewport, which are only multiplied out
+   and inverted again after one of them has changed.  Without them the
+   lines and points are left alone.
+ */
+static GLfloat screenMvp[16], screenInv[16];
+static GLint screenViewport[4];
+static unsigned long screenGeneration = (unsigned long) -1;
+static int screenKnown = 0;
+static GLubyte *screenScratch = NULL;	/* the block being replaced */
+static int screenScratchBytes = 0;
+
+/* Multiply the point x,y,z,1 by m. */
+static void
+transform_point (GLfloat *out, const GLfloat *m, const GLfloat *p)
+{
+    int i;
+    for (i = 0; i < 4; i++)
+        out[i] = m[i] * p[0] + m[4+i] * p[1] + m[8+i] * p[2] + m[12+i];
+}
+
+/* Returns 1 if screenMvp, screenInv and screenViewport are current. */
+static int
+screen_known (void)
+{
+    if (screenGeneration != matrix_generation)
+    {
+        screenGeneration = matrix_generation;
+        screenKnown = (matrix_mvp (screenMvp) &&
+                       matrix_invert (screenInv, screenMvp) &&
+                       matrix_get_viewport (screenViewport));
+    }
+    return screenKnown;
+}
+
+/* Returns 1 if quads can be lined up with the screen, with *ccw set to
+   the winding culling leaves alone: lines and points are never culled.
+ */
+static int
+screen_quads_ok (int *ccw)
+{
+    if (!screen_known ())
+        return 0;
+
+    *ccw = 1;
+    if (state->enabled & ISENABLED_CULL_FACE)
+    {
+        void_int front, cull;
+        front.i = GL_CCW;
+        cull.i = GL_BACK;
+        front = shadow_value (SHADOW_FRONT_FACE, front);
+        cull = shadow_value (SHADOW_CULL_FACE, cull);
+        if (cull.i == GL_FRONT_AND_BACK)
+            return 0;
+        *ccw = ((front.i == GL_CCW) == (cull.i == GL_BACK));
+    }
+    return 1;
+}
+
+/* Copy the n vertexes of the primitive in progress aside and take them
+   out of the batch, to be replaced.  Returns the copy, or 0.
+ */
+static GLubyte *
+take_block (int n)
+{
+    if (n * vertStride > screenScratchBytes)
+    {
+        GLubyte *p = (GLubyte *) realloc (screenScratch, n * vertStride);
+        if (!p)
+            return 0;
+        screenScratch = p;
+        screenScratchBytes = n * vertStride;
+    }
+    memcpy (screenScratch, ptrVertexAttribArrayMark, n * vertStride);
+    ptrVertexAttribArray = ptrVertexAttribArrayMark;
+    return screenScratch;
+}
+
+/* Add a copy of vertex `from' at clip coordinates c moved by ox, oy in
+   normalized device coordinates, and with texture coordinates st if
+   given.  Returns 0 if there was no room.
+ */
+static int
+emit_screen_vertex (const GLubyte *from, const GLfloat *c,
+                    GLfloat ox, GLfloat oy, const GLfloat *st)
+{
+    GLfloat clip[4], obj[4];
+    int i;
+
+    if (ptrVertexAttribArray == ptrVertexAttribArrayEnd &&
+        !batch_make_room ())
+        return 0;
+
+    clip[0] = c[0] + ox * c[3];
+    clip[1] = c[1] + oy * c[3];
+    clip[2] = c[2];
+    clip[3] = c[3];
+    for (i = 0; i < 4; i++)
+        obj[i] = (screenInv[i] * clip[0] + screenInv[4+i] * clip[1] +
+                  screenInv[8+i] * clip[2] + screenInv[12+i] * clip[3]);
+
+    memcpy (ptrVertexAttribArray, from, vertStride);
+    for (i = 0; i < 3; i++)
+        ((GLfloat *) ptrVertexAttribArray)[i] = obj[i] / obj[3];
+    if (obj[2] != 0)
+        batchHasZ = 1;
+    if (st && batchTexCoords)
+        memcpy (ptrVertexAttribArray + vertTexOffset, st, 2 * sizeof(GLfloat));
+    ptrVertexAttribArray += vertStride;
+    return 1;
+}
+
+
+/* With JWZGLES_WIDE_LINES, lines are turned into quads as wide as the
+   line width, so that they look the same on every driver.  glLineWidth
+   is kept from the driver meanwhile (see jwzgles_glBegin).
+   GL_LINE_SMOOTH is not emulated.
+ */
+static int wideLines = 0;
+static unsigned long linesWidened = 0;
+
+/* Replace the n vertexes of the line primitive in progress with one quad
+   per segment.  Returns the number of vertexes it left, or -1 if it
+   can't do it and the lines should be drawn as such.
+ */
+static int
+widen_lines (int n)
+{
+    GLubyte *block;
+    void_int dflt;
+    GLfloat hx, hy;
+    int nsegs, seg, ccw;
+
+    if (!screen_quads_ok (&ccw) || !(block = take_block (n)))
+        return -1;
+
+    /* Half the width, in normalized device coordinates. */
+    dflt.f = 1;
+    hx = shadow_value (SHADOW_LINE_WIDTH, dflt).f / screenViewport[2];
+    hy = shadow_value (SHADOW_LINE_WIDTH, dflt).f / screenViewport[3];
+
+    nsegs = (wrapperPrimitiveMode == GL_LINES      ? n / 2 :
+             wrapperPrimitiveMode == GL_LINE_STRIP ? n - 1 : n);
+
+    for (seg = 0; seg < nsegs; seg++)
+    {
+        int ia = (wrapperPrimitiveMode == GL_LINES ? seg * 2 : seg);
+        int ib = (wrapperPrimitiveMode == GL_LINES ? seg * 2 + 1 :
+                  (seg + 1) % n);
+        GLubyte *va = block + ia * vertStride;
+        GLubyte *vb = block + ib * vertStride;
+        GLfloat pa[3], pb[3], ca[4], cb[4];
+        GLfloat dx, dy, len, ox, oy;
+        int k;
+
+        memcpy (pa, va, sizeof(pa));
+        memcpy (pb, vb, sizeof(pb));
+        transform_point (ca, screenMvp, pa);
+        transform_point (cb, screenMvp, pb);
+
+        /* Cut the segment off where it goes behind the eye. */
+# define NEAR_W 1e-5
+        if (ca[3] < NEAR_W && cb[3] < NEAR_W)
+            continue;
+        if (ca[3] < NEAR_W || cb[3] < NEAR_W)
+        {
+            GLfloat t = (NEAR_W - ca[3]) / (cb[3] - ca[3]);
+            GLfloat *p = (ca[3] < NEAR_W ? pa : pb);
+            for (k = 0; k < 3; k++)
+                p[k] = pa[k] + (pb[k] - pa[k]) * t;
+            transform_point ((ca[3] < NEAR_W ? ca : cb), screenMvp, p);
+        }
+# undef NEAR_W
+
+        dx = (cb[0] / cb[3] - ca[0] / ca[3]) * screenViewport[2];
+        dy = (cb[1] / cb[3] - ca[1] / ca[3]) * screenViewport[3];
+        len = sqrtf (dx * dx + dy * dy);
+        if (len < 1e-6)
+        {
+            dx = 1;
+            dy = 0;
+            len = 1;
+        }
+        ox = -dy / len * hx;
+        oy =  dx / len * hy;
+
+        /* Right of a, right of b, left of b, left of a: counterclockwise
+           on the screen.
+         */
+        for (k = 0; k < 4; k++)
+        {
+            int corner = (ccw ? k : 3 - k);
+            int at_b = (corner == 1 || corner == 2);
+            GLfloat side = (corner < 2 ? -1 : 1);
+
+            if (!emit_screen_vertex ((at_b ? vb : va), (at_b ? cb : ca),
+                                     side * ox, side * oy, 0))
+                return VERT_COUNT (ptrVertexAttribArrayMark,
+                                   ptrVertexAttribArray) & ~3;
+        }
+        linesWidened++;
+    }
+
+    return VERT_COUNT (ptrVertexAttribArrayMark, ptrVertexAttribArray);
+}
+
+
+/* Points go into the batch with their size when the driver has
+   GL_OES_point_size_array, so that points of any size share a draw.
+   Otherwise they are turned into quads of the point size.  For those,
+   GL_POINT_SPRITE_OES with GL_COORD_REPLACE_OES on the first unit is
+   done by giving the corners texture coordinates; GL_POINT_SMOOTH and
+   the point parameters are not emulated.
+ */
+static unsigned long pointsWidened = 0;
+
+static int
+point_sprite_coords (void)
+{
+    shadow_slot *s;
+
+    if (!(state->enabled & ISENABLED_POINT_SPRITE))
+        return 0;
+    s = shadow_find (SHADOW_TEX_ENV, GL_POINT_SPRITE_OES,
+                     GL_COORD_REPLACE_OES, GL_TEXTURE0);
+    return (s && s->count && s->val[0].f != 0);
+}
+
+/* Replace the n points in progress with a quad each.  Returns the
+   number of vertexes it left, or -1 if they should be drawn as points.
+ */
+static int
+widen_points (int n)
+{
+    /* Counterclockwise from the bottom left: x, y, then s, t with the
+       origin at the top left as for sprites. */
+    static const GLfloat corners[4][4] = {
+        { -1, -1,  0, 1 },
+        {  1, -1,  1, 1 },
+        {  1,  1,  1, 0 },
+        { -1,  1,  0, 0 },
+    };
+    GLubyte *block;
+    void_int dflt;
+    GLfloat hx, hy;
+    int i, k, ccw, sprite = point_sprite_coords ();
+
+    if (!screen_quads_ok (&ccw) || !(block = take_block (n)))
+        return -1;
+
+    /* Half the size, in normalized device coordinates. */
+    dflt.f = 1;
+    hx = shadow_value (SHADOW_POINT_SIZE, dflt).f / screenViewport[2];
+    hy = shadow_value (SHADOW_POINT_SIZE, dflt).f / screenViewport[3];
+
+    for (i = 0; i < n; i++)
+    {
+        GLubyte *v = block + i * vertStride;
+        GLfloat p[3], c[4];
+
+        memcpy (p, v, sizeof(p));
+        transform_point (c, screenMvp, p);
+
+        /* As with real points, one whose centre is clipped is dropped. */
+        if (c[3] <= 0 || fabsf (c[0]) > c[3] || fabsf (c[1]) > c[3] ||
+            fabsf (c[2]) > c[3])
+            continue;
+
+        for (k = 0; k < 4; k++)
+        {
+            const GLfloat *q = corners[ccw ? k : 3 - k];
+            if (!emit_screen_vertex (v, c, q[0] * hx, q[1] * hy,
+                                     (sprite ? q + 2 : 0)))
+                return VERT_COUNT (ptrVertexAttribArrayMark,
+                                   ptrVertexAttribArray) & ~3;
+        }
+        pointsWidened++;
+    }
+
+    return VERT_COUNT (ptrVertexAttribArrayMark, ptrVertexAttribArray);
+}
+
+
+/* Start a block of vertexes at the end of the batch. */
+static void
+begin_block (GLenum mode)
+{
+    glBegin_active = 1;
+    wrapperPrimitiveMode = mode;
+    vertexMark = vertexCount;
+    ptrVertexAttribArrayMark = ptrVertexAttribArray;
+    indexbase = indexCount;
+}
+
+/* What split_block keeps of a block, and the first vertex of a line
+   loop that it split.
+ */
+static GLubyte *splitCarry = NULL;
+static int splitCarryBytes = 0;
+static GLubyte loopFirst[sizeof(VertexAttrib)];
+static int loopFirstStride = 0;
+static int loopFirstKept = 0;
+
+static int block_widens (GLenum mode);
+static int widened_verts (int n);
+
+void
+jwzgles_glBegin(int mode)
+{
+    int points = (mode == GL_POINTS);
+    int lines = (mode == GL_LINES || mode == GL_LINE_STRIP ||
+                 mode == GL_LINE_LOOP);
+    unsigned long held = 0;
+    int normals, texcoords;
+    int ccw;
+
+    LOGI("glBegin mode = %d, vcount = %d, icount = %d", mode,vertexCount,indexCount);
+
+    if(!arena.verts)
+    {
+        arena_init ();
+        reset_batch ();
+    }
+
+    /* The driver's line width and point size only matter to what it
+       draws as lines and points, so changing them need not draw the
+       batch before anything else.
+     */
+    if (!lines || (wideLines && screen_quads_ok (&ccw)))
+        held |= SHADOW_BIT (SHADOW_LINE_WIDTH);
+    if (!points || havePointSizeArray || screen_quads_ok (&ccw))
+        held |= SHADOW_BIT (SHADOW_POINT_SIZE);
+    commit_state_except (held);
+
+    /* Lit batches carry normals, and textured ones texture coordinates;
+       others don't pay for them.  Either changing has drawn the batch.
+     */
+    normals = !!(enabled_applied & ISENABLED_LIGHTING);
+    texcoords = !!(enabled_applied & ISENABLED_TEXTURE_2D);
+    if (normals != batchNormals || texcoords != batchTexCoords)
+        set_vertex_layout (compactVerts, normals, texcoords);
+
+    if (points && havePointSizeArray)
+    {
+        void_int dflt;
+        dflt.f = 1;
+        currentVertexAttrib.psize = currentVertexPacked.psize =
+            shadow_value (SHADOW_POINT_SIZE, dflt).f;
+    }
+
+    /* Likewise the second unit's coordinates, until some turn up, and
+       the point sizes, until some points do.
+     */
+    if (ptrVertexAttribArray == arena.verts)
+    {
+        if (batchMulti)
+            glMultiTexCoord4f (GL_TEXTURE1, currentVertexPacked.s_multi,
+                               currentVertexPacked.t_multi, 0, 1);
+        set_batch_parts (0, points && havePointSizeArray);
+    }
+    else if (points && havePointSizeArray)
+        set_batch_parts (batchMulti, 1);
+
+    loopFirstKept = 0;
+    begin_block (mode);
+}
+
+
+/* glEnd turns these into quads itself. */
+static int
+block_widens (GLenum mode)
+{
+    if (mode == GL_POINTS)
+        return !havePointSizeArray;
+    return (wideLines &&
+            (mode == GL_LINES || mode == GL_LINE_STRIP ||
+             mode == GL_LINE_LOOP));
+}
+
+/* How many vertexes the n of the block in progress become as quads. */
+static int
+widened_verts (int n)
+{
+    switch (wrapperPrimitiveMode)
+    {
+    case GL_LINES:
+        return n / 2 * 4;
+    case GL_LINE_STRIP:
+        return (n > 1 ? (n - 1) * 4 : 0);
+    default:			/* points, line loops */
+        return n * 4;
+    }
+}
+
+/* The glBegin block in progress fills the batch by itself.  Draw the
+   primitives it has completed, and start it again in a new batch with
+   the vertexes the rest still needs: the incomplete primitive of a
+   list, the last vertex of a line strip, the first and the last of a
+   fan or polygon, the last two of a strip.  A strip only carries on
+   with the same winding after an even number of vertexes, so an odd
+   one waits for the next batch too.  A line loop keeps its first vertex
+   aside to close on at glEnd.
+
+   Blocks that glEnd widens are drawn a part at a time small enough for
+   the quads to fit, and keep the rest.  Returns 0 if nothing could be
+   drawn.
+ */
+static int
+split_block (void)
+{
+    GLenum mode = wrapperPrimitiveMode;
+    GLubyte *block = ptrVertexAttribArrayMark;
+    int n = VERT_COUNT (block, ptrVertexAttribArray);
+    int draw = n, from = n, centre = 0;
+    int per_quad = 0;
+    int recolored = batchRecolored, has_z = batchHasZ;
+    int bytes;
+
+    switch (mode)
+    {
+    case GL_POINTS:
+        per_quad = 1;
+        break;
+    case GL_LINES:
+        draw = from = n - n % 2;
+        per_quad = 2;
+        break;
+    case GL_LINE_STRIP:
+    case GL_LINE_LOOP:
+        from = n - 1;
+        per_quad = 1;
+        break;
+    case GL_TRIANGLES:
+        draw = from = n - n % 3;
+        break;
+    case GL_QUADS:
+        draw = from = n - n % 4;
+        break;
+    case GL_TRIANGLE_STRIP:
+    case GL_QUAD_STRIP:
+        draw = n - n % 2;
+        from = draw - 2;
+        break;
+    case GL_TRIANGLE_FAN:
+    case GL_POLYGON:
+        from = n - 1;
+        centre = 1;
+        break;
+    default:
+        return 0;
+    }
+
+    /* Each point, or segment, becomes 4 vertexes. */
+    if (per_quad && block_widens (mode))
+    {
+        int most = maxBatchVerts / 4 * per_quad;
+        if (mode != GL_POINTS && mode != GL_LINES)
+            most++;		/* n - 1 segments */
+        if (draw > most)
+        {
+            draw = most;
+            from = (mode == GL_LINES || mode == GL_POINTS ? draw : draw - 1);
+        }
+    }
+
+    if (draw <= 0 || centre + n - from >= n)
+        return 0;
+
+    /* Keep what carries over, drawing may write over it. */
+    bytes = (centre + n - from) * vertStride;
+    if (bytes > splitCarryBytes)
+    {
+        GLubyte *p = (GLubyte *) realloc (splitCarry, bytes);
+        if (!p)
+            return 0;
+        splitCarry = p;
+        splitCarryBytes = bytes;
+    }
+    if (centre)
+        memcpy (splitCarry, block, vertStride);
+    memcpy (splitCarry + centre * vertStride, block + from * vertStride,
+            (n - from) * vertStride);
+
+    if (mode == GL_LINE_LOOP && !loopFirstKept)
+    {
+        memcpy (loopFirst, block, vertStride);
+        loopFirstStride = vertStride;
+        loopFirstKept = 1;
+    }
+
+    ptrVertexAttribArray = block + draw * vertStride;
+    if (mode == GL_LINE_LOOP)
+        wrapperPrimitiveMode = GL_LINE_STRIP;
+    jwzgles_glEnd ();
+    FlushOnStateChange ();
+
+    begin_block (mode);
+    memcpy (ptrVertexAttribArray, splitCarry, bytes);
+    ptrVertexAttribArray += bytes;
+    if (recolored)	/* what carried over may differ */
+        batchRecolored = 1;
+    batchHasZ = has_z;
+    batchSplits++;
+    return 1;
+}
+
+
+/* With JWZGLES_FRUSTUM_CULL at N, glEnd drops a block of N or more
+   vertexes whose bounding box is wholly outside one side of the view
+   volume, so that it is neither copied into the batch nor drawn.  Lines
+   and points wider than a pixel are kept, since they can reach in from
+   outside.
+ */
+static int frustumCull = 0;
+static unsigned long blocksCulled = 0;
+
+static int
+block_outside (int n)
+{
+    const GLubyte *v = ptrVertexAttribArrayMark;
+    GLfloat lo[3], hi[3], p[3], c[4];
+    GLenum mode = wrapperPrimitiveMode;
+    int outside = 0x3F;		/* planes every corner is beyond */
+    int i, j;
+
+    if (mode == GL_LINES || mode == GL_LINE_STRIP || mode == GL_LINE_LOOP ||
+        mode == GL_POINTS)
+    {
+        void_int dflt;
+        dflt.f = 1;
+        if (shadow_value (mode == GL_POINTS ? SHADOW_POINT_SIZE
+                          : SHADOW_LINE_WIDTH, dflt).f > 1)
+            return 0;
+    }
+    if (!screen_known ())
+        return 0;
+
+    memcpy (lo, v, sizeof(lo));
+    memcpy (hi, v, sizeof(hi));
+    for (i = 1, v += vertStride; i < n; i++, v += vertStride)
+    {
+        memcpy (p, v, sizeof(p));
+        for (j = 0; j < 3; j++)
+        {
+            if (p[j] < lo[j]) lo[j] = p[j];
+            if (p[j] > hi[j]) hi[j] = p[j];
+        }
+    }
+
+    for (i = 0; i < 8 && outside; i++)
+    {
+        int planes = 0;
+
+        p[0] = (i & 1 ? hi[0] : lo[0]);
+        p[1] = (i & 2 ? hi[1] : lo[1]);
+        p[2] = (i & 4 ? hi[2] : lo[2]);
+        transform_point (c, screenMvp, p);
+        for (j = 0; j < 3; j++)
+        {
+            if (c[j] < -c[3]) planes |= 1 << (j * 2);
+            if (c[j] >  c[3]) planes |= 2 << (j * 2);
+        }
+        outside &= planes;
+    }
+    return outside != 0;
+}
+
+
+/* Add the indexes of the block in progress. */
+static void
+batch_indexes (int pattern, int count)
+{
+    ptrIndexArray = emit_pattern (ptrIndexArray, INDEXES_ROOM(), pattern,
+                                  indexbase, count);
+}
+
+void jwzgles_glEnd(void)
+{
+    int n;
+    GLenum draw_mode = GL_TRIANGLES;
+    int min_verts = 3;
+
+    LOGI("glEnd");
+
+    /* Turned into quads, the block has to fit in one batch. */
+    while (block_widens (wrapperPrimitiveMode) &&
+           widened_verts (VERT_COUNT (ptrVertexAttribArrayMark,
+                                      ptrVertexAttribArray)) >
+           maxBatchVerts - VERT_COUNT (arena.verts, ptrVertexAttribArrayMark))
+    {
+        if (ptrVertexAttribArrayMark > arena.verts)
+            split_batch ();
+        else if (!split_block ())
+            break;
+    }
+
+    /* A line loop that split_block cut up ends on its first vertex. */
+    if (wrapperPrimitiveMode == GL_LINE_LOOP && loopFirstKept)
+    {
+        if (ptrVertexAttribArray != ptrVertexAttribArrayEnd ||
+            batch_make_room ())
+        {
+            vertex_from_current (ptrVertexAttribArray);
+            memcpy (ptrVertexAttribArray, loopFirst,
+                    (loopFirstStride == vertStride
+                     ? vertStride : vertBaseBytes));
+            ptrVertexAttribArray += vertStride;
+        }
+        wrapperPrimitiveMode = GL_LINE_STRIP;
+        loopFirstKept = 0;
+    }
+
+    n = VERT_COUNT (ptrVertexAttribArrayMark, ptrVertexAttribArray);
+    glBegin_active = 0;
+
+    if (frustumCull && n >= frustumCull && block_outside (n))
+    {
+        ptrVertexAttribArray = ptrVertexAttribArrayMark;  /* nothing drawn */
+        blocksCulled++;
+        return;
+    }
+
+    if ((n >= 2 || wrapperPrimitiveMode == GL_POINTS) &&
+        block_widens (wrapperPrimitiveMode))
+    {
+        int quads = (wrapperPrimitiveMode == GL_POINTS
+                     ? widen_points (n) : widen_lines (n));
+        if (quads >= 0)
+        {
+            n = quads;
+            wrapperPrimitiveMode = GL_QUADS;
+        }
+    }
+
+    switch (wrapperPrimitiveMode)
+    {
+    case GL_POINTS:
+        draw_mode = GL_POINTS;
+        min_verts = 1;
+        break;
+    case GL_LINES:
+    case GL_LINE_STRIP:
+    case GL_LINE_LOOP:
+        draw_mode = GL_LINES;
+        min_verts = 2;
+        break;
+    case GL_QUADS:
+        /* Leftovers of a quad would throw the quadIbo pattern off. */
+        n -= n % 4;
+        ptrVertexAttribArray = ptrVertexAttribArrayMark + n * vertStride;
+        break;
+    case GL_QUAD_STRIP:
+        n -= n % 2;
+        ptrVertexAttribArray = ptrVertexAttribArrayMark + n * vertStride;
+        min_verts = 4;
+        break;
+    case GL_TRIANGLES:
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+    case GL_POLYGON:
+        break;
+    default:
+        Assert (0, "glEnd: unknown primitive");
+        n = 0;
+        break;
+    }
+
+    if (n < min_verts)
+    {
+        ptrVertexAttribArray = ptrVertexAttribArrayMark;  /* nothing drawn */
+        return;
+    }
+
+    indexCount = indexbase = VERT_COUNT (arena.verts, ptrVertexAttribArrayMark);
+
+    /* No mode needs more than 3 indexes per vertex.  Points, lines and
+       triangles can't share a draw call.
+     */
+    if ((wrapperPrimitiveMode != GL_QUADS && !batch_quad_indexes ()) ||
+        !arena_reserve_indexes (n * 3) ||
+        ((!batchNRuns || draw_mode != batchDrawMode) &&
+         !batch_new_run (draw_mode)))
+    {
+        ptrVertexAttribArray = ptrVertexAttribArrayMark;  /* dropped */
+        return;
+    }
+
+    switch (wrapperPrimitiveMode)
+    {
+    case GL_POINTS:
+        batch_indexes (PATTERN_POINTS, n);
+        break;
+    case GL_LINES:
+        batch_indexes (PATTERN_LINES, n - n % 2);
+        break;
+    case GL_LINE_STRIP:
+    case GL_LINE_LOOP:
+        batch_indexes (PATTERN_LINE_STRIP, (n - 1) * 2);
+        if (wrapperPrimitiveMode == GL_LINE_LOOP)
+            EMIT_INDEXES (
+                *out++ = indexbase + n - 1;
+                *out++ = indexbase);
+        break;
+    case GL_QUADS:
+        if (!batchAllQuads)
+            batch_indexes (PATTERN_QUADS, n / 4 * 6);
+        break;
+    case GL_QUAD_STRIP:
+        batch_indexes (PATTERN_QUAD_STRIP, (n - 2) / 2 * 6);
+        break;
+    case GL_TRIANGLES:
+        batch_indexes (PATTERN_TRIANGLES, n - n % 3);
+        break;
+    case GL_TRIANGLE_STRIP:
+        batch_indexes (PATTERN_TRIANGLE_STRIP, (n - 2) * 3);
+        break;
+    case GL_POLYGON:
+    case GL_TRIANGLE_FAN:
+        batch_indexes (PATTERN_TRIANGLE_FAN, (n - 2) * 3);
+        break;
+
+    default:
+        break;
+    }
+
+    indexCount = indexbase + n;
+    vertexCount = (batchAllQuads ? indexCount / 4 * 6
+                   : (GLuint) INDEXES_USED());
+    batchRuns[batchNRuns - 1].count =
+        vertexCount - batchRuns[batchNRuns - 1].first;
+
+    //FlushOnStateChange(); //TEST
+}
+
+
+/* Fill in a vertex of the batch with the current attributes. */
+static void
+vertex_from_current (GLubyte *vert)
+{
+    if (compactVerts)
+    {
+        memcpy (vert, &currentVertexPacked, vertBaseBytes);
+        if (batchMulti)
+            memcpy (vert + vertTexMultiOffset, &currentVertexPacked.s_multi,
+                    2 * sizeof(GLfloat));
+        if (batchNormals)
+            memcpy (vert + vertNormalOffset, &currentVertexPacked.nx, 4);
+        if (batchPointSizes)
+            memcpy (vert + vertPointSizeOffset, &currentVertexPacked.psize,
+                    sizeof(GLfloat));
+    }
+    else
+    {
+        memcpy (vert, &currentVertexAttrib, vertBaseBytes);
+        if (batchMulti)
+            memcpy (vert + vertTexMultiOffset, &currentVertexAttrib.s_multi,
+                    2 * sizeof(GLfloat));
+        if (batchNormals)
+            memcpy (vert + vertNormalOffset, &currentVertexAttrib.nx, 4);
+        if (batchPointSizes)
+            memcpy (vert + vertPointSizeOffset, &currentVertexAttrib.psize,
+                    sizeof(GLfloat));
+    }
+}
+
+void jwzgles_glVertex4fv (const GLfloat *v)
+{
+    GLubyte *vert;
+
+    if (ptrVertexAttribArray == ptrVertexAttribArrayEnd &&
+        !batch_make_room ())
+        return;
+
+    vert = ptrVertexAttribArray;
+    vertex_from_current (vert);
+    memcpy (vert, v, 3 * sizeof(GLfloat));	/* both start with x, y, z */
+    if (v[2] != 0)
+        batchHasZ = 1;
+    ptrVertexAttribArray += vertStride;
+}
+
+void
+jwzgles_glTexCoord4fv (const GLfloat *v)
+{
+    currentVertexAttrib.s = currentVertexPacked.s = v[0];
+    currentVertexAttrib.t = currentVertexPacked.t = v[1];
+}
+
+/* The second unit's coordinates only go into the batch once they change
+   under vertexes already in it; until then the driver's current value
+   does for the whole batch.
+ */
+void
+jwzgles_glMultiTexCoord2fARB (GLenum target, GLfloat s, GLfloat t)
+{
+    if (target == GL_TEXTURE0)
+    {
+        GLfloat v[4] = { s, t, 0, 1 };
+        jwzgles_glTexCoord4fv (v);
+        return;
+    }
+
+    if (target != GL_TEXTURE1)
+    {
+        glMultiTexCoord4f (target, s, t, 0, 1);
+        return;
+    }
+
+    if (!batchMulti)
+    {
+        if (s == currentVertexPacked.s_multi &&
+            t == currentVertexPacked.t_multi)
+            return;
+        if (ptrVertexAttribArray == arena.verts)	/* nothing pending */
+            glMultiTexCoord4f (GL_TEXTURE1, s, t, 0, 1);
+        else
+            set_batch_parts (1, batchPointSizes);
+    }
+
+    currentVertexAttrib.s_multi = currentVertexPacked.s_multi = s;
+    currentVertexAttrib.t_multi = currentVertexPacked.t_multi = t;
+}
+
+void
+jwzgles_glMultiTexCoord2f (GLenum target, GLfloat s, GLfloat t)
+{
+    jwzgles_glMultiTexCoord2fARB (target, s, t);
+}
+
+/* GL_BYTE normals map -128..127 to -1..1.  A longer normal is scaled
+   down to fit; without GL_NORMALIZE its length was wrong anyway.
+ */
+static void
+normal_bytes (GLbyte *out, const GLfloat *v)
+{
+    GLfloat m = fabsf (v[0]);
+    GLfloat scale = 127;
+
+    if (fabsf (v[1]) > m) m = fabsf (v[1]);
+    if (fabsf (v[2]) > m) m = fabsf (v[2]);
+    if (m > 1)
+        scale /= m;
+
+    out[0] = lrintf (v[0] * scale);
+    out[1] = lrintf (v[1] * scale);
+    out[2] = lrintf (v[2] * scale);
+}
+
+void
+jwzgles_glNormal3fv (const GLfloat *v)
+{
+    GLbyte n[3];
+
+    normal_bytes (n, v);
+    currentNormal[0] = v[0];
+    currentNormal[1] = v[1];
+    currentNormal[2] = v[2];
+    currentVertexAttrib.nx = currentVertexPacked.nx = n[0];
+    currentVertexAttrib.ny = currentVertexPacked.ny = n[1];
+    currentVertexAttrib.nz = currentVertexPacked.nz = n[2];
+
+    if(!glBegin_active)
+        glNormal3f (v[0], v[1], v[2]);
+}
+
+void
+jwzgles_glColor4fv (const GLfloat *v)
+{
+    if (compactVerts)
+    {
+        currentVertexPacked.red   = color_byte (v[0]);
+        currentVertexPacked.green = color_byte (v[1]);
+        currentVertexPacked.blue  = color_byte (v[2]);
+        currentVertexPacked.alpha = color_byte (v[3]);
+    }
+    else
+    {
+        currentVertexAttrib.red = v[0];
+        currentVertexAttrib.green =  v[1];
+        currentVertexAttrib.blue =  v[2];
+        currentVertexAttrib.alpha =  v[3];
+    }
+    jwzgles_note_color (&jwzgles_cursor);
+
+    if(!glBegin_active)
+        glColor4f (v[0], v[1], v[2], v[3]);
+}
+
+/* Byte colours go straight into the compact layout. */
+void
+jwzgles_glColor4ub (GLubyte r, GLubyte g, GLubyte b, GLubyte a)
+{
+    if (compactVerts)
+    {
+        currentVertexPacked.red   = r;
+        currentVertexPacked.green = g;
+        currentVertexPacked.blue  = b;
+        currentVertexPacked.alpha = a;
+    }
+    else
+    {
+        currentVertexAttrib.red   = r / 255.0f;
+        currentVertexAttrib.green = g / 255.0f;
+        currentVertexAttrib.blue  = b / 255.0f;
+        currentVertexAttrib.alpha = a / 255.0f;
+    }
+    jwzgles_note_color (&jwzgles_cursor);
+
+    if(!glBegin_active)
+        glColor4ub (r, g, b, a);
+}
+
+/* color_byte on four floats at once. */
+static void
+color_bytes (GLubyte *out, const GLfloat *c)
+{
+#if defined(__SSE2__)
+    __m128 v = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (c), _mm_setzero_ps ()),
+                           _mm_set1_ps (1));
+    __m128i i = _mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (v,
+                                                          _mm_set1_ps (255)),
+                                              _mm_set1_ps (0.5f)));
+    int rgba;
+
+    i = _mm_packs_epi32 (i, i);
+    i = _mm_packus_epi16 (i, i);
+    rgba = _mm_cvtsi128_si32 (i);
+    memcpy (out, &rgba, 4);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t v = vminq_f32 (vmaxq_f32 (vld1q_f32 (c), vdupq_n_f32 (0)),
+                               vdupq_n_f32 (1));
+    uint16x4_t h = vmovn_u32 (vcvtq_u32_f32 (
+                                  vmlaq_n_f32 (vdupq_n_f32 (0.5f), v, 255)));
+    uint8x8_t b = vmovn_u16 (vcombine_u16 (h, h));
+    uint32_t rgba = vget_lane_u32 (vreinterpret_u32_u8 (b), 0);
+
+    memcpy (out, &rgba, 4);
+#else
+    out[0] = color_byte (c[0]);
+    out[1] = color_byte (c[1]);
+    out[2] = color_byte (c[2]);
+    out[3] = color_byte (c[3]);
+#endif
+}
+
+/* Like glBegin, then glColor4fv, glTexCoord2fv and glVertex3fv for each
+   vertex, then glEnd: the vertexes go into the batch with whatever is
+   drawn around them.  A stride of 0 means tightly packed, as for
+   glVertexPointer; null colour or texture coordinates leave the current
+   ones on every vertex.  The arrays are copied a stretch of arena at a
+   time.
+ */
+void
+jwzgles_emit_vertices (GLenum mode, int count,
+                       const GLfloat *pos, int pos_stride,
+                       const GLfloat *color, int color_stride,
+                       const GLfloat *tex, int tex_stride)
+{
+    const GLubyte *p = (const GLubyte *) pos;
+    const GLubyte *c = (const GLubyte *) color;
+    const GLubyte *t = (const GLubyte *) tex;
+    GLubyte first[sizeof(VertexAttrib)];
+
+    if (count <= 0 || !pos)
+        return;
+
+    if (!pos_stride)   pos_stride   = 3 * sizeof(GLfloat);
+    if (!color_stride) color_stride = 4 * sizeof(GLfloat);
+    if (!tex_stride)   tex_stride   = 2 * sizeof(GLfloat);
+
+    jwzgles_glBegin (mode);
+
+    while (count > 0)
+    {
+        GLubyte *vert = ptrVertexAttribArray;
+        int n = VERT_COUNT (vert, ptrVertexAttribArrayEnd);
+        int tail = vertStride - vertBaseBytes;
+        int i;
+
+        if (!n)
+        {
+            if (!batch_make_room ())
+                break;
+            continue;
+        }
+        if (n > count)
+            n = count;
+
+        /* Only what the arrays don't give is copied from this, in
+           pieces of a size known here so that they aren't calls.
+         */
+        vertex_from_current (first);
+        for (i = 0; i < n; i++, vert += vertStride)
+        {
+            memcpy (vert, p, 3 * sizeof(GLfloat));
+            if (((const GLfloat *) vert)[2] != 0)
+                batchHasZ = 1;
+            p += pos_stride;
+
+            if (!c)
+            {
+                if (compactVerts)
+                    memcpy (vert + vertColorOffset, first + vertColorOffset,
+                            4);
+                else
+                    memcpy (vert + vertColorOffset, first + vertColorOffset,
+                            4 * sizeof(GLfloat));
+            }
+            else
+            {
+                if (compactVerts)
+                    color_bytes (vert + vertColorOffset, (const GLfloat *) c);
+                else
+                    memcpy (vert + vertColorOffset, c, 4 * sizeof(GLfloat));
+                c += color_stride;
+            }
+
+            if (t)
+            {
+                if (batchTexCoords)
+                    memcpy (vert + vertTexOffset, t, 2 * sizeof(GLfloat));
+                t += tex_stride;
+            }
+            else if (batchTexCoords)
+                memcpy (vert + vertTexOffset, first + vertTexOffset,
+                        2 * sizeof(GLfloat));
+
+            if (tail)
+                memcpy (vert + vertBaseBytes, first + vertBaseBytes, tail);
+        }
+
+        ptrVertexAttribArray = vert;
+        if (c)
+            batchRecolored = 1;
+        count -= n;
+    }
+
+    /* What was given last stays current, as it would have. */
+    if (c && c != (const GLubyte *) color)
+        jwzgles_glColor4fv ((const GLfloat *) (c - color_stride));
+    if (t && t != (const GLubyte *) tex)
+        jwzgles_glTexCoord4fv ((const GLfloat *) (t - tex_stride));
+
+    jwzgles_glEnd ();
+}
+
+/* With JWZGLES_MERGE_ARRAYS at N, a glDrawArrays of up to N vertexes
+   from client memory goes into the batch as if it had been a glBegin
+   block, instead of drawing the batch and then itself by itself.  The
+   arrays are read through what the *Pointer calls were given: float
+   positions, texture coordinates and normals, and float or byte
+   colours.  Anything else, or an array in a VBO, is drawn as before.
+ */
+static int mergeArrays = 0;
+static unsigned long arraysMerged = 0;
+
+static int
+array_mergeable (const draw_array *A, int min_size, int alt_type)
+{
+    return (A->binding == 0 && A->data && A->size >= min_size &&
+            (A->type == GL_FLOAT || A->type == alt_type));
+}
+
+static const GLubyte *
+array_element (const draw_array *A, GLuint i, int *stride)
+{
+    *stride = array_stride (A);
+    return (const GLubyte *) A->data + i * *stride;
+}
+
+/* One colour from the app's array, in the batch's colour layout. */
+static void
+color_from_array (GLubyte *out, const draw_array *A, const GLubyte *c)
+{
+    GLfloat f[4];
+    int i;
+
+    if (A->type == GL_UNSIGNED_BYTE)
+    {
+        if (compactVerts)
+        {
+            memcpy (out, c, 3);
+            out[3] = (A->size > 3 ? c[3] : 255);
+            return;
+        }
+        for (i = 0; i < 4; i++)
+            f[i] = (i < A->size ? c[i] : 255) / 255.0f;
+    }
+    else
+    {
+        memcpy (f, c, (A->size > 3 ? 4 : 3) * sizeof(GLfloat));
+        if (A->size < 4)
+            f[3] = 1;
+    }
+
+    if (compactVerts)
+        color_bytes (out, f);
+    else
+        memcpy (out, f, sizeof(f));
+}
+
+static int
+merge_draw_arrays (GLenum mode, GLuint first, GLuint count)
+{
+    unsigned long on = state->enabled;
+    const draw_array *V = &state->vert_array;
+    const draw_array *C = &state->color_array;
+    const draw_array *T = &state->tex_array;
+    const draw_array *N = &state->norm_array;
+    const GLubyte *p, *c = 0, *t = 0, *nv = 0;
+    int p_stride, c_stride = 0, t_stride = 0, n_stride = 0;
+    GLubyte tmpl[sizeof(VertexAttrib)];
+
+    if (count == 0 || count > (GLuint) mergeArrays || mode > GL_POLYGON ||
+        state->compiling_verts)
+        return 0;
+    if (on & (ISENABLED_TEXTURE_GEN_S | ISENABLED_TEXTURE_GEN_T |
+              ISENABLED_TEXTURE_GEN_R | ISENABLED_TEXTURE_GEN_Q))
+        return 0;
+    if (state->otherTexArrays)	/* the batch only has unit 0's */
+        return 0;
+
+    if (!(on & ISENABLED_VERT_ARRAY) || !array_mergeable (V, 2, GL_FLOAT) ||
+        V->size > 4)
+        return 0;
+    p = array_element (V, first, &p_stride);
+
+    if (on & ISENABLED_COLOR_ARRAY)
+    {
+        if (!array_mergeable (C, 3, GL_UNSIGNED_BYTE))
+            return 0;
+        c = array_element (C, first, &c_stride);
+    }
+
+    /* Texture coordinates and normals are only read if they will be
+       used, since the app may have left an array on that it never set.
+     */
+    if ((on & ISENABLED_TEX_ARRAY) && (on & ISENABLED_TEXTURE_2D))
+    {
+        if (!array_mergeable (T, 2, GL_FLOAT))
+            return 0;
+        t = array_element (T, first, &t_stride);
+    }
+    if ((on & ISENABLED_NORM_ARRAY) && (on & ISENABLED_LIGHTING))
+    {
+        if (!array_mergeable (N, 3, GL_FLOAT))
+            return 0;
+        nv = array_element (N, first, &n_stride);
+    }
+
+    jwzgles_glBegin (mode);
+    vertex_from_current (tmpl);
+
+    while (count > 0)
+    {
+        GLubyte *vert = ptrVertexAttribArray;
+        GLuint n = VERT_COUNT (vert, ptrVertexAttribArrayEnd);
+        GLuint i;
+
+        if (!n)
+        {
+            if (!batch_make_room ())
+                break;
+            continue;
+        }
+        if (n > count)
+            n = count;
+
+        for (i = 0; i < n; i++, vert += vertStride)
+        {
+            GLfloat xyz[4] = { 0, 0, 0, 1 };
+
+            memcpy (vert, tmpl, vertStride);
+
+            /* A w other than 1 is divided out, which puts the vertex
+               in the same place.
+             */
+            memcpy (xyz, p, V->size * sizeof(GLfloat));
+            if (xyz[3] != 1 && xyz[3] != 0)
+            {
+                xyz[0] /= xyz[3];
+                xyz[1] /= xyz[3];
+                xyz[2] /= xyz[3];
+            }
+            memcpy (vert, xyz, 3 * sizeof(GLfloat));
+            if (xyz[2] != 0)
+                batchHasZ = 1;
+            p += p_stride;
+
+            if (c)
+            {
+                color_from_array (vert + vertColorOffset, C, c);
+                c += c_stride;
+            }
+            if (t)
+            {
+                if (batchTexCoords)
+                    memcpy (vert + vertTexOffset, t, 2 * sizeof(GLfloat));
+                t += t_stride;
+            }
+            if (nv)
+            {
+                if (batchNormals)
+                    normal_bytes ((GLbyte *) (vert + vertNormalOffset),
+                                  (const GLfloat *) nv);
+                nv += n_stride;
+            }
+        }
+
+        ptrVertexAttribArray = vert;
+        if (c)
+            batchRecolored = 1;
+        count -= n;
+    }
+
+    jwzgles_glEnd ();
+    arraysMerged++;
+    return 1;
+}
+
+/* Element i of the app's array as floats, whatever its type, scaled to
+   0..1 or -1..1 if `norm' and it is of an integer type.  Components
+   that it doesn't have are left as they were.
+ */
+static void
+array_floats (const draw_array *A, GLint i, GLfloat *out, int norm)
+{
+    int stride, j;
+    const GLubyte *e = array_element (A, i, &stride);
+
+    for (j = 0; j < A->size && j < 4; j++)
+    {
+        switch (A->type)
+        {
+        case GL_UNSIGNED_BYTE:
+            out[j] = e[j] * (norm ? 1 / 255.0f : 1);
+            break;
+        case GL_BYTE:
+            out[j] = ((const GLbyte *) e)[j] * (norm ? 1 / 127.0f : 1);
+            break;
+        case GL_SHORT:
+            out[j] = ((const GLshort *) e)[j] * (norm ? 1 / 32767.0f : 1);
+            break;
+        case GL_UNSIGNED_SHORT:
+            out[j] = ((const GLushort *) e)[j] * (norm ? 1 / 65535.0f : 1);
+            break;
+        case GL_INT:
+            out[j] = ((const GLint *) e)[j] * (norm ? 1 / 2147483647.0 : 1);
+            break;
+        case GL_UNSIGNED_INT:
+            out[j] = ((const GLuint *) e)[j] * (norm ? 1 / 4294967295.0 : 1);
+            break;
+        case GL_FIXED:
+            out[j] = ((const GLfixed *) e)[j] / 65536.0f;
+            break;
+        case GL_FLOAT:
+            out[j] = ((const GLfloat *) e)[j];
+            break;
+        case GL_DOUBLE:
+            out[j] = ((const GLdouble *) e)[j];
+            break;
+        default:
+            Assert (0, "unknown array type");
+            break;
+        }
+    }
+}
+
+/* Only arrays in client memory can be read: GLES 1 can't read a VBO. */
+#define ARRAY_READABLE(A) ((A)->binding == 0 && (A)->data)
+
+/* The element's normal, colour and texture coordinates become current,
+   as if given to glNormal3fv, glColor4fv and glTexCoord4fv, and inside
+   glBegin its position goes into the batch as glVertex4fv's would.
+ */
+void
+jwzgles_glArrayElement (GLint i)
+{
+    unsigned long on = state->enabled;
+    const draw_array *A;
+    GLfloat v[4];
+    int stride;
+
+    A = &state->norm_array;
+    if ((on & ISENABLED_NORM_ARRAY) && ARRAY_READABLE (A))
+    {
+        array_floats (A, i, v, 1);
+        jwzgles_glNormal3fv (v);
+    }
+
+    A = &state->color_array;
+    if ((on & ISENABLED_COLOR_ARRAY) && ARRAY_READABLE (A))
+    {
+        if (A->type == GL_UNSIGNED_BYTE && A->size == 4)
+        {
+            const GLubyte *c = array_element (A, i, &stride);
+            jwzgles_glColor4ub (c[0], c[1], c[2], c[3]);
+        }
+        else
+        {
+            v[3] = 1;
+            array_floats (A, i, v, 1);
+            jwzgles_glColor4fv (v);
+        }
+    }
+
+    A = &state->tex_array;
+    if ((on & ISENABLED_TEX_ARRAY) && ARRAY_READABLE (A))
+    {
+        v[1] = 0;
+        array_floats (A, i, v, 0);
+        jwzgles_glTexCoord4fv (v);
+    }
+
+    A = &state->vert_array;
+    if ((on & ISENABLED_VERT_ARRAY) && glBegin_active && ARRAY_READABLE (A))
+    {
+        v[2] = 0;
+        array_floats (A, i, v, 0);
+        jwzgles_glVertex4fv (v);
+    }
+}
+
+/* GLES 1 has no quads and, without GL_OES_element_index_uint, no 32-bit
+   indexes.  So glDrawElements and glDrawArrays turn quads, quad strips
+   and polygons into triangles, and 32-bit indexes into 16-bit ones;
+   a mesh that reaches past 65536 vertexes is drawn in pieces, with the
+   array pointers moved along for each.  Indexes in an element buffer
+   are read from the copy that glBufferData keeps.
+
+   Conversions are remembered by where the indexes came from: the
+   buffer, the offset into it and the generation of its contents, or
+   the client pointer and a hash of what it points at.  The first time
+   one turns up it is drawn from memory, and the second time it is put
+   in a buffer of its own, so that a mesh that doesn't change is only
+   converted twice rather than every frame.
+ */
+#define CONVERT_SLOTS	32
+#define INDEX_LIMIT	0x10000		/* vertexes 16-bit indexes reach */
+
+typedef struct
+{
+    GLuint buffer;
+    GLubyte *data;
+    long bytes;
+    unsigned long generation;
+} element_copy;
+
+typedef struct
+{
+    GLuint base;		/* vertex the indexes count from */
+    int first, count;		/* in the converted indexes */
+} convert_run;
+
+typedef struct
+{
+    const void *ptr;		/* client indexes, or offset into buffer */
+    GLuint buffer;
+    uint64_t generation;	/* the buffer's, or a hash of the indexes */
+    GLenum mode, type;		/* type 0 = glDrawArrays */
+    GLuint first;
+    int count;
+    GLenum draw_mode, draw_type;
+    convert_run *runs;
+    int nruns;
+    GLuint ibo;			/* 0 = only seen once so far */
+    unsigned long used;		/* 0 = free */
+} convert_slot;
+
+static element_copy *elementCopies = NULL;
+static int elementNCopies = 0, elementCopiesSize = 0;
+static unsigned long elementGeneration = 0;
+
+static convert_slot convertSlots[CONVERT_SLOTS];
+static unsigned long convertClock = 0;
+static unsigned long indexesConverted = 0;
+static unsigned long convertHits = 0;
+
+static GLuint *convertList = NULL;	/* the indexes, in the new mode */
+static int convertListSize = 0;
+static void *convertOut = NULL;		/* and as they are drawn */
+static int convertOutSize = 0;
+static convert_run *convertRuns = NULL;
+static int convertRunsSize = 0;
+
+/* Make room for n elements of `span' bytes in *array. */
+static int
+convert_grow (void **array, int *size, int n, int span)
+{
+    void *a;
+
+    if (n <= *size)
+        return 1;
+    a = realloc (*array, (long) n * span);
+    Assert (a, "out of memory");
+    if (!a)
+        return 0;
+    *array = a;
+    *size = n;
+    return 1;
+}
+
+static element_copy *
+find_element_copy (GLuint buffer)
+{
+    int i;
+
+    for (i = 0; i < elementNCopies; i++)
+        if (elementCopies[i].buffer == buffer)
+            return &elementCopies[i];
+    return 0;
+}
+
+static void
+forget_element_data (GLuint buffer)
+{
+    element_copy *e = find_element_copy (buffer);
+
+    if (!e)
+        return;
+    free (e->data);
+    *e = elementCopies[--elementNCopies];
+}
+
+static void
+note_element_data (GLuint buffer, const void *data, long bytes)
+{
+    element_copy *e;
+    GLubyte *p;
+
+    if (!buffer)
+        return;
+
+    e = find_element_copy (buffer);
+    if (!e)
+    {
+        if (!convert_grow ((void **) &elementCopies, &elementCopiesSize,
+                           elementNCopies + 1, sizeof(*e)))
+            return;
+        e = &elementCopies[elementNCopies++];
+        memset (e, 0, sizeof(*e));
+        e->buffer = buffer;
+    }
+
+    p = (GLubyte *) realloc (e->data, bytes ? bytes : 1);
+    Assert (p, "out of memory");
+    if (!p)
+    {
+        forget_element_data (buffer);
+        return;
+    }
+    e->data = p;
+    e->bytes = bytes;
+    if (data)
+        memcpy (p, data, bytes);
+    else
+        memset (p, 0, bytes);
+    e->generation = ++elementGeneration;
+}
+
+/* glBufferSubData changed part of an element buffer.  The new generation
+   keeps conversions of the old contents from being drawn again.
+ */
+static void
+patch_element_data (GLuint buffer, long offset, const void *data, long bytes)
+{
+    element_copy *e = find_element_copy (buffer);
+
+    if (!e || !data)
+        return;
+    if (offset < 0 || bytes < 0 || offset + bytes > e->bytes)
+        return;			/* GL_INVALID_VALUE: nothing changed */
+    memcpy (e->data + offset, data, bytes);
+    e->generation = ++elementGeneration;
+}
+
+static void
+convert_drop (convert_slot *c)
+{
+    if (c->ibo)
+        glDeleteBuffers (1, &c->ibo);
+    free (c->runs);
+    memset (c, 0, sizeof(*c));
+}
+
+/* The i'th index drawn: from the indexes, or counting from `first'. */
+static GLuint
+source_index (const GLubyte *src, GLenum type, GLuint first, int i)
+{
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE:
+        return src[i];
+    case GL_UNSIGNED_SHORT:
+        return ((const GLushort *) src)[i];
+    case GL_UNSIGNED_INT:
+        return ((const GLuint *) src)[i];
+    default:
+        return first + i;
+    }
+}
+
+/* The pattern that turns n of mode's vertexes into what is drawn, and
+   how many indexes that makes.  Strips, fans and loops are only taken
+   apart when they have to be drawn in pieces.
+ */
+static int
+convert_pattern (GLenum mode, int n, int split, GLenum *draw_mode,
+                 int *count)
+{
+    int p = PATTERN_POINTS;
+
+    *draw_mode = GL_TRIANGLES;
+    switch (mode)
+    {
+    case GL_QUADS:
+        p = PATTERN_QUADS;
+        *count = n / 4 * 6;
+        break;
+    case GL_QUAD_STRIP:
+        p = PATTERN_QUAD_STRIP;
+        *count = (n - 2) / 2 * 6;
+        break;
+    case GL_POLYGON:
+    case GL_TRIANGLE_FAN:
+        p = PATTERN_TRIANGLE_FAN;
+        *count = (n - 2) * 3;
+        break;
+    case GL_TRIANGLE_STRIP:
+        p = PATTERN_TRIANGLE_STRIP;
+        *count = (n - 2) * 3;
+        break;
+    case GL_LINE_STRIP:
+    case GL_LINE_LOOP:
+        p = PATTERN_LINE_STRIP;
+        *draw_mode = GL_LINES;
+        *count = (n - 1) * 2;
+        break;
+    }
+
+    if (p == PATTERN_POINTS ||
+        (!split && p != PATTERN_QUADS && p != PATTERN_QUAD_STRIP &&
+         mode != GL_POLYGON))
+    {
+        p = PATTERN_POINTS;	/* as they are */
+        *draw_mode = mode;
+        *count = n;
+    }
+    if (*count < 0)
+        *count = 0;
+    return p;
+}
+
+/* Convert into convertOut and convertRuns.  Returns the number of runs,
+   or -1 if it can't be drawn this way.
+ */
+static int
+convert_indexes (GLenum mode, GLenum type, const GLubyte *src, GLuint first,
+                 int n, GLenum *draw_mode, GLenum *draw_type)
+{
+    GLuint lo = first, hi = first + n - 1;
+    int split, p, total, g, i, k, nruns = 0, open = 0;
+    GLuint *list;
+
+    if (type)
+        for (lo = ~0U, hi = 0, k = 0; k < n; k++)
+        {
+            GLuint v = source_index (src, type, first, k);
+            if (v < lo) lo = v;
+            if (v > hi) hi = v;
+        }
+
+    split = (hi >= INDEX_LIMIT && indexType != GL_UNSIGNED_INT);
+    if (split && !client_arrays_known ())
+    {
+        Assert (0, "can't move arrays that weren't given to us");
+        return -1;
+    }
+
+    p = convert_pattern (mode, n, split, draw_mode, &total);
+    if (!convert_grow ((void **) &convertList, &convertListSize,
+                       total + 2, sizeof(GLuint)))
+        return -1;
+
+    list = convertList;
+    for (k = 0; k < total; k++)
+    {
+        int len = pattern_units[p].len;
+        int e = k % len;
+        int at = pattern_units[p].index[e];
+        if (!((pattern_units[p].fixed >> e) & 1))
+            at += k / len * pattern_units[p].advance;
+        list[k] = source_index (src, type, first, at);
+    }
+    if (mode == GL_LINE_LOOP && p == PATTERN_LINE_STRIP && n > 1)
+    {
+        list[total++] = source_index (src, type, first, n - 1);
+        list[total++] = source_index (src, type, first, 0);
+    }
+
+    if (!split)
+    {
+        *draw_type = (hi >= INDEX_LIMIT ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT);
+        if (!convert_grow ((void **) &convertRuns, &convertRunsSize, 1,
+                           sizeof(convert_run)))
+            return -1;
+        convertRuns[0].base = 0;
+        convertRuns[0].first = 0;
+        convertRuns[0].count = total;
+        nruns = 1;
+    }
+    else
+    {
+        /* Whole primitives at a time, as many as 16 bits reach.  One
+           that spans more than that can't be drawn at all.
+         */
+        g = (*draw_mode == GL_TRIANGLES ? 3 : *draw_mode == GL_LINES ? 2 : 1);
+        *draw_type = GL_UNSIGNED_SHORT;
+        total -= total % g;
+        for (k = 0; k < total; k += g)
+        {
+            GLuint plo = list[k], phi = list[k];
+            for (i = 1; i < g; i++)
+            {
+                if (list[k + i] < plo) plo = list[k + i];
+                if (list[k + i] > phi) phi = list[k + i];
+            }
+            if (phi - plo >= INDEX_LIMIT)
+            {
+                open = 0;
+                continue;
+            }
+            if (open &&
+                (phi > hi ? phi : hi) - (plo < lo ? plo : lo) < INDEX_LIMIT)
+            {
+                if (plo < lo) lo = plo;
+                if (phi > hi) hi = phi;
+                convertRuns[nruns - 1].base = lo;
+                convertRuns[nruns - 1].count += g;
+                continue;
+            }
+            if (!convert_grow ((void **) &convertRuns, &convertRunsSize,
+                               nruns + 1, sizeof(convert_run)))
+                return -1;
+            lo = plo;
+            hi = phi;
+            convertRuns[nruns].base = lo;
+            convertRuns[nruns].first = k;
+            convertRuns[nruns].count = g;
+            nruns++;
+            open = 1;
+        }
+    }
+
+    if (!convert_grow (&convertOut, &convertOutSize, total,
+                       (*draw_type == GL_UNSIGNED_INT
+                        ? sizeof(GLuint) : sizeof(GLushort))))
+        return -1;
+
+    for (i = 0; i < nruns; i++)
+    {
+        const convert_run *r = &convertRuns[i];
+        if (*draw_type == GL_UNSIGNED_INT)
+            memcpy ((GLuint *) convertOut + r->first, list + r->first,
+                    r->count * sizeof(GLuint));
+        else
+            for (k = r->first; k < r->first + r->count; k++)
+                ((GLushort *) convertOut)[k] = list[k] - r->base;
+    }
+    return nruns;
+}
+
+static void
+draw_converted (GLenum mode, GLenum type, const GLubyte *indexes,
+                const convert_run *runs, int nruns)
+{
+    int bytes = (type == GL_UNSIGNED_INT ? sizeof(GLuint) : sizeof(GLushort));
+    GLuint base = 0;
+    int i;
+
+    for (i = 0; i < nruns; i++)
+    {
+        if (runs[i].base != base)
+        {
+            if (!client_arrays_known ())
+                break;
+            base = runs[i].base;
+            set_client_arrays (base);
+        }
+        glDrawElements (mode, runs[i].count, type,
+                        indexes + runs[i].first * bytes);
+    }
+    CHECK("draw_converted");
+
+    if (base)
+        set_client_arrays (0);
+}
+
+/* Draw it converted, if it needs to be.  Returns 0 to draw it as is. */
+static int
+convert_draw (GLenum mode, GLenum type, const void *indexes, GLuint first,
+              int count)
+{
+    int bytes = (type == GL_UNSIGNED_INT ? sizeof(GLuint) :
+                 type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : 1);
+    const GLubyte *src = (const GLubyte *) indexes;
+    GLuint buffer = (type ? state->element_array_buffer : 0);
+    uint64_t generation = 0;
+    convert_slot *c = 0, *victim = &convertSlots[0];
+    GLenum draw_mode, draw_type;
+    int nruns, i;
+
+    if (mode != GL_QUADS && mode != GL_QUAD_STRIP && mode != GL_POLYGON &&
+        (type != GL_UNSIGNED_INT || indexType == GL_UNSIGNED_INT))
+        return 0;
+    if (count <= 0)
+        return 1;
+
+    if (buffer)
+    {
+        element_copy *e = find_element_copy (buffer);
+        long offset = (long) (const GLubyte *) indexes;
+
+        if (!e || offset < 0 || offset + (long) count * bytes > e->bytes)
+        {
+            Assert (0, "indexes not in a buffer we know");
+            return 0;
+        }
+        src = e->data + offset;
+        generation = e->generation;
+    }
+    else if (type)
+        generation = hash_bytes (type, src, count * bytes);
+
+    convertClock++;
+    for (i = 0; i < CONVERT_SLOTS; i++)
+    {
+        convert_slot *s = &convertSlots[i];
+        if (s->used && s->ptr == indexes && s->buffer == buffer &&
+            s->generation == generation && s->mode == mode &&
+            s->type == type && s->first == first && s->count == count)
+        {
+            c = s;
+            break;
+        }
+        if (s->used < victim->used)
+            victim = s;
+    }
+
+    if (c && c->ibo)
+    {
+        c->used = convertClock;
+        convertHits++;
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, c->ibo);
+        draw_converted (c->draw_mode, c->draw_type, 0, c->runs, c->nruns);
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, buffer);
+        return 1;
+    }
+
+    nruns = convert_indexes (mode, type, src, first, count,
+                             &draw_mode, &draw_type);
+    if (nruns < 0)
+        return 0;
+    indexesConverted++;
+    if (!nruns)
+        return 1;
+
+    if (!c)			/* first time: just remember it */
+    {
+        convert_drop (victim);
+        victim->ptr = indexes;
+        victim->buffer = buffer;
+        victim->generation = generation;
+        victim->mode = mode;
+        victim->type = type;
+        victim->first = first;
+        victim->count = count;
+        victim->used = convertClock;
+    }
+    else			/* second time: keep it */
+    {
+        int size = (convertRuns[nruns - 1].first +
+                    convertRuns[nruns - 1].count) *
+                   (draw_type == GL_UNSIGNED_INT ? sizeof(GLuint)
+                    : sizeof(GLushort));
+
+        c->used = convertClock;
+        c->runs = (convert_run *) malloc (nruns * sizeof(*c->runs));
+        if (c->runs)
+            glGenBuffers (1, &c->ibo);
+        if (c->ibo)
+        {
+            memcpy (c->runs, convertRuns, nruns * sizeof(*c->runs));
+            c->nruns = nruns;
+            c->draw_mode = draw_mode;
+            c->draw_type = draw_type;
+            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, c->ibo);
+            glBufferData (GL_ELEMENT_ARRAY_BUFFER, size, convertOut,
+                          GL_STATIC_DRAW);
+            draw_converted (draw_mode, draw_type, 0, convertRuns, nruns);
+            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, buffer);
+            return 1;
+        }
+        convert_drop (c);
+    }
+
+    if (buffer)
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    draw_converted (draw_mode, draw_type, (const GLubyte *) convertOut,
+                    convertRuns, nruns);
+    if (buffer)
+        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, buffer);
+    return 1;
+}
+
+/* Work out where things are in a vertex of the layout in use. */
+static void
+vertex_offsets (void)
+{
+    if (compactVerts)
+    {
+        vertColorType = GL_UNSIGNED_BYTE;
+        vertColorOffset = offsetof(VertexAttribPacked, red);
+        vertTexOffset = offsetof(VertexAttribPacked, s);
+        vertBaseBytes = (batchTexCoords
+                         ? (int) offsetof(VertexAttribPacked, s_multi)
+                         : vertTexOffset);
+    }
+    else
+    {
+        vertColorType = GL_FLOAT;
+        vertColorOffset = offsetof(VertexAttrib, red);
+        vertTexOffset = offsetof(VertexAttrib, s);
+        vertBaseBytes = (batchTexCoords
+                         ? (int) offsetof(VertexAttrib, s_multi)
+                         : vertTexOffset);
+    }
+
+    vertStride = vertBaseBytes;
+    vertTexMultiOffset = vertStride;
+    if (batchMulti)
+        vertStride += 2 * sizeof(GLfloat);
+    vertNormalOffset = vertStride;
+    if (batchNormals)
+        vertStride += 4;
+    vertPointSizeOffset = vertStride;
+    if (batchPointSizes)
+        vertStride += sizeof(GLfloat);
+
+    jwzgles_cursor.plain = (compactVerts && vertStride == vertBaseBytes);
+    jwzgles_cursor.textured = batchTexCoords;
+    jwzgles_cursor.stride = vertStride;
+}
+
+/* Add or drop the optional parts that can change without drawing the
+   batch: the second unit's texture coordinates and the point size.
+   Vertexes already in the batch are widened in place and get the values
+   that were current until now.  Parts are only dropped from an empty
+   batch.
+ */
+static void
+set_batch_parts (int multi, int psizes)
+{
+    int old_stride = vertStride;
+    int old_multi = batchMulti, old_multi_at = vertTexMultiOffset;
+    int old_psizes = batchPointSizes, old_psize_at = vertPointSizeOffset;
+    int old_normal_at = vertNormalOffset;
+    int n = VERT_COUNT (arena.verts, ptrVertexAttribArray);
+    int mark = VERT_COUNT (arena.verts, ptrVertexAttribArrayMark);
+    const GLubyte *cur_multi = (compactVerts
+                                ? (GLubyte *) &currentVertexPacked.s_multi
+                                : (GLubyte *) &currentVertexAttrib.s_multi);
+    const GLubyte *cur_psize = (compactVerts
+                                ? (GLubyte *) &currentVertexPacked.psize
+                                : (GLubyte *) &currentVertexAttrib.psize);
+    int i;
+
+    multi = !!multi;
+    psizes = !!psizes;
+    if (multi == batchMulti && psizes == batchPointSizes)
+        return;
+
+    /* The buckets hold vertexes in the old layout. */
+    if (sortNBuckets)
+        drain_buckets ();
+
+    batchMulti = multi;
+    batchPointSizes = psizes;
+    vertex_offsets ();
+
+    if (!arena.verts)
+        return;
+
+    /* A full batch may need more room once widened. */
+    if (n * vertStride > arena.vert_bytes)
+    {
+        int new_bytes = arena.vert_bytes * 2;
+        GLubyte *verts;
+
+        while (n * vertStride > new_bytes)
+            new_bytes *= 2;
+        verts = (GLubyte *) realloc (arena.verts, new_bytes);
+        Assert (verts, "out of memory");
+        if (!verts)
+        {
+            batchMulti = old_multi;
+            batchPointSizes = old_psizes;
+            vertex_offsets ();
+            return;
+        }
+        arena.verts = verts;
+        arena.vert_bytes = new_bytes;
+    }
+
+    for (i = n - 1; i >= 0; i--)
+    {
+        GLubyte tmp[sizeof(VertexAttrib)];
+        GLubyte *to = arena.verts + i * vertStride;
+        memcpy (tmp, arena.verts + i * old_stride, old_stride);
+        memcpy (to, tmp, vertBaseBytes);
+        if (batchMulti)
+            memcpy (to + vertTexMultiOffset,
+                    (old_multi ? tmp + old_multi_at : cur_multi),
+                    2 * sizeof(GLfloat));
+        if (batchNormals)
+            memcpy (to + vertNormalOffset, tmp + old_normal_at, 4);
+        if (batchPointSizes)
+            memcpy (to + vertPointSizeOffset,
+                    (old_psizes ? tmp + old_psize_at : cur_psize),
+                    sizeof(GLfloat));
+    }
+    Assert ((multi >= old_multi && psizes >= old_psizes) || !n,
+            "dropped a vertex part from a non-empty batch");
+
+    ptrVertexAttribArray = arena.verts + n * vertStride;
+    ptrVertexAttribArrayMark = arena.verts + mark * vertStride;
+    arena_moved ();
+}
+
+/* Switch the arena between the float and the RGBA8 layout, with or
+   without normals.  The batch is drawn first, so the arena is empty
+   and only has to be told the new stride.
+ */
+static void
+set_vertex_layout (int compact, int normals, int texcoords)
+{
+    compact = !!compact;
+    normals = !!normals;
+    texcoords = !!texcoords;
+    if (compact == compactVerts && normals == batchNormals &&
+        texcoords == batchTexCoords)
+        return;
+
+    if (glBegin_active)
+    {
+        Assert (0, "can't change the vertex layout inside glBegin");
+        return;
+    }
+
+    FlushOnStateChange();
+
+    if (compact != compactVerts && compact)
+    {
+        currentVertexPacked.red   = color_byte (currentVertexAttrib.red);
+        currentVertexPacked.green = color_byte (currentVertexAttrib.green);
+        currentVertexPacked.blue  = color_byte (currentVertexAttrib.blue);
+        currentVertexPacked.alpha = color_byte (currentVertexAttrib.alpha);
+    }
+    else if (compact != compactVerts)
+    {
+        currentVertexAttrib.red   = currentVertexPacked.red   / 255.0f;
+        currentVertexAttrib.green = currentVertexPacked.green / 255.0f;
+        currentVertexAttrib.blue  = currentVertexPacked.blue  / 255.0f;
+        currentVertexAttrib.alpha = currentVertexPacked.alpha / 255.0f;
+    }
+
+    compactVerts = compact;
+    batchNormals = normals;
+    batchTexCoords = texcoords;
+    vertex_offsets ();
+
+    if (arena.verts)
+    {
+        reset_batch ();
+        arena_moved ();
+    }
+}
+
+/* The app calls this once per frame, e.g. just before swapping buffers.
+   It draws whatever is still pending, hands the driver any state that
+   is still waiting for a draw, lets the batch arena decide whether it
+   has been oversized for long enough to shrink, and ages the batch
+   cache.
+ */
+void
+jwzgles_end_frame (void)
+{
+    commit_state ();
+    FlushOnStateChange();
+    arena_end_frame ();
+    cache_end_frame ();
+}
+
+void
+jwzgles_batch_option (int option, int value)
+{
+    switch (option)
+    {
+    case JWZGLES_ARENA_SHRINK_FRAMES:
+        arena.shrink_frames = (value > 0 ? value : -1);
+        break;
+    case JWZGLES_COMPACT_VERTS:
+        compactWanted = !!value;
+        if (arena.verts)
+            set_vertex_layout (value, batchNormals, batchTexCoords);
+        break;
+    case JWZGLES_VBO_RING:
+        FlushOnStateChange();
+        ring_resize (value);
+        break;
+    case JWZGLES_SORT_BY_TEXTURE:
+        if (!value)
+        {
+            FlushOnStateChange();
+            free_buckets ();
+        }
+        sortByTexture = !!value;
+        break;
+    case JWZGLES_WIDE_LINES:
+        wideLines = !!value;
+        break;
+    case JWZGLES_MERGE_ARRAYS:
+        mergeArrays = (value > 0 ? value : 0);
+        break;
+    case JWZGLES_FRUSTUM_CULL:
+        frustumCull = (value > 0 ? value : 0);
+        break;
+    case JWZGLES_BATCH_CACHE:
+        FlushOnStateChange();
+        cache_resize (value);
+        break;
+    case JWZGLES_BATCH_VERTS:
+        FlushOnStateChange();
+        batchVertsCap = (value > 0 ? (value < 64 ? 64 : value) : 0);
+        maxBatchVerts = (indexType == GL_UNSIGNED_INT ? 0x7FFFFFFF : 0x10000);
+        if (batchVertsCap && batchVertsCap < maxBatchVerts)
+            maxBatchVerts = batchVertsCap;
+        if (arena.verts)
+            arena_moved ();
+        break;
+    default:
+        Assert (0, "jwzgles_batch_option: unknown option");
+        break;
+    }
+}
+
+long
+jwzgles_batch_stat (int stat)
+{
+    switch (stat)
+    {
+    case JWZGLES_STAT_ARENA_VERTS:
+        return arena.vert_bytes / vertStride;
+    case JWZGLES_STAT_ARENA_INDEXES:
+        return arena.index_size;
+    case JWZGLES_STAT_ARENA_VERTS_HWM:
+        return arena.vert_hwm;
+    case JWZGLES_STAT_ARENA_INDEXES_HWM:
+        return arena.index_hwm;
+    case JWZGLES_STAT_ARENA_BYTES:
+        return (arena.vert_bytes + arena.index_size * indexBytes);
+    case JWZGLES_STAT_BATCH_SPLITS:
+        return batchSplits;
+    case JWZGLES_STAT_VERTEX_STRIDE:
+        return vertStride;
+    case JWZGLES_STAT_STATE_FILTERED:
+        return shadow_filtered;
+    case JWZGLES_STAT_SORT_QUEUED:
+        return sortQueued;
+    case JWZGLES_STAT_RING_UPLOADED:
+        return ringUploaded;
+    case JWZGLES_STAT_QUAD_BATCHES:
+        return quadBatches;
+    case JWZGLES_STAT_LINES_WIDENED:
+        return linesWidened;
+    case JWZGLES_STAT_POINTS_WIDENED:
+        return pointsWidened;
+    case JWZGLES_STAT_CONSTANT_COLOR:
+        return constColorBatches;
+    case JWZGLES_STAT_FLAT_BATCHES:
+        return flatBatches;
+    case JWZGLES_STAT_CACHE_HITS:
+        return cacheHits;
+    case JWZGLES_STAT_CACHE_BYTES:
+        return cacheBytes;
+    case JWZGLES_STAT_ARRAYS_MERGED:
+        return arraysMerged;
+    case JWZGLES_STAT_INDEXES_CONVERTED:
+        return indexesConverted;
+    case JWZGLES_STAT_CONVERT_HITS:
+        return convertHits;
+    case JWZGLES_STAT_BLOCKS_CULLED:
+        return blocksCulled;
+    default:
+        Assert (0, "jwzgles_batch_stat: unknown stat");
+        return 0;
+    }
 }
\ No newline at end of file